@@ -0,0 +1,65 @@
+#ifndef __LEARNING_GEM5_MSI_EG_ADDR_BATCH_HH__
+#define __LEARNING_GEM5_MSI_EG_ADDR_BATCH_HH__
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#include "base/logging.hh"
+#include "base/types.hh"
+
+//A small fixed-size list of block addresses. The L1 collects the clean blocks it dropped silently in
+//one, and sends it to the directory as a single PutSBatch message (see MSI-cache.sm)
+class AddrBatch
+{
+	public:
+		//MSI-dir.sm unrolls its loop over a batch, keep the two in sync
+		static const int MaxSize = 4;
+
+	private:
+		Addr addrs[MaxSize];
+		uint8_t count;
+
+	public:
+		AddrBatch() : count(0) {}
+
+		int size() const { return count; }
+		Addr at(int i) const { assert(i < count); return addrs[i]; }
+		bool isFull(int limit) const { return count >= std::min(limit, MaxSize); }
+
+		void add(Addr addr)
+		{
+			panic_if(count == MaxSize, "PutS batch is full\n");
+			addrs[count++] = addr;
+		}
+
+		void remove(Addr addr)
+		{
+			Addr *end = addrs + count;
+			Addr *it = std::find(addrs, end, addr);
+			if(it != end)
+			{
+				std::copy(it + 1, end, it);
+				count--;
+			}
+		}
+
+		void clear() { count = 0; }
+
+		void print(std::ostream& out) const
+		{
+			out << "[";
+			for(int i = 0; i < count; i++)
+				out << " " << std::hex << addrs[i] << std::dec;
+			out << " ]";
+		}
+};
+
+inline std::ostream&
+operator<<(std::ostream& out, const AddrBatch& batch)
+{
+	batch.print(out);
+	return out;
+}
+
+#endif
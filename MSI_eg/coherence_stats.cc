@@ -0,0 +1,51 @@
+#include "learning_gem5/MSI_eg/coherence_stats.hh"
+
+#include "mem/ruby/system/RubySystem.hh"
+
+CoherenceStats::CoherenceStats(const std::string& name)
+{
+	//Controllers are created before stats are enabled, so the stats can be registered here
+	dramWritesAvoided.name(name+".dramWritesAvoided")
+									 .desc("Number of dirty blocks shared without writing them back to memory");
+
+	dirEvictions.name(name+".dirEvictions")
+							.desc("Number of directory entries evicted to make room");
+
+	dirRecalls.name(name+".dirRecalls")
+						.desc("Number of caches invalidated or recalled by directory evictions");
+
+	upgradeAcks.name(name+".upgradeAcks")
+						 .desc("Number of upgrades from S answered without data");
+
+	upgradeBytesSaved.name(name+".upgradeBytesSaved")
+									 .desc("Data bytes not sent on the response network for upgrades");
+
+	putSElided.name(name+".putSElided")
+						.desc("Number of clean evictions not sent as a PutS of their own");
+
+	putSBatches.name(name+".putSBatches")
+						 .desc("Number of batched PutS messages sent");
+
+	controlMsgsSaved.name(name+".controlMsgsSaved")
+									.desc("Number of PutS and PutAck messages saved by silent or batched evictions");
+
+	migrationsDetected.name(name+".migrationsDetected")
+										.desc("Number of times a block was classified as migratory");
+
+	migratoryGrants.name(name+".migratoryGrants")
+								 .desc("Number of GetS answered with write permission for a migratory block");
+
+	migratoryMisses.name(name+".migratoryMisses")
+								 .desc("Number of migratory grants the reader never wrote");
+
+	migratoryTransactionsSaved.name(name+".migratoryTransactionsSaved")
+														.desc("Number of write requests saved by migratory grants");
+	migratoryTransactionsSaved = migratoryGrants - migratoryMisses;
+}
+
+void CoherenceStats::dataUpgrade()
+{
+	upgradeAcks++;
+	//An ack count is a control message, the data message it replaces also carries the block
+	upgradeBytesSaved += RubySystem::getBlockSizeBytes();
+}
@@ -0,0 +1,53 @@
+#ifndef __LEARNING_GEM5_MSI_EG_COHERENCE_STATS_HH__
+#define __LEARNING_GEM5_MSI_EG_COHERENCE_STATS_HH__
+
+#include <string>
+
+#include "base/statistics.hh"
+
+//Counters for protocol events that the generated Ruby controllers do not track on their own. SLICC
+//cannot declare stats, so each controller holds one of these as an external structure (see
+//MSI-stats.sm) and calls into it from its actions. The stats are named after the owning controller.
+class CoherenceStats
+{
+	private:
+		//Reads of a dirty block served by its owner which did not update memory first (MOSI)
+		Stats::Scalar dramWritesAvoided;
+
+		//Entries evicted from a bounded directory cache, and the Inv/Recall messages they caused
+		Stats::Scalar dirEvictions;
+		Stats::Scalar dirRecalls;
+
+		//Upgrades answered with an ack count instead of data, and the data bytes this kept off the
+		//response network
+		Stats::Scalar upgradeAcks;
+		Stats::Scalar upgradeBytesSaved;
+
+		//Clean evictions without their own PutS/PutAck pair, the batches that reported some of them,
+		//and the control messages this saved in total
+		Stats::Scalar putSElided;
+		Stats::Scalar putSBatches;
+		Stats::Scalar controlMsgsSaved;
+
+		//Blocks classified as migratory, reads answered with write permission because of it, and those
+		//where the reader never wrote. The follow-up GetM/Upgrade was saved for all but the last
+		Stats::Scalar migrationsDetected;
+		Stats::Scalar migratoryGrants;
+		Stats::Scalar migratoryMisses;
+		Stats::Formula migratoryTransactionsSaved;
+
+	public:
+		CoherenceStats(const std::string& name);
+
+		void dramWriteAvoided() { dramWritesAvoided++; }
+		void directoryEviction() { dirEvictions++; }
+		void directoryRecalls(int caches) { dirRecalls += caches; }
+		void dataUpgrade();
+		void cleanEvictionElided() { putSElided++; controlMsgsSaved += 2; }
+		void putSBatchSent() { putSBatches++; controlMsgsSaved -= 1; }
+		void migrationDetected() { migrationsDetected++; }
+		void migratoryGrant() { migratoryGrants++; }
+		void migratoryMiss() { migratoryMisses++; }
+};
+
+#endif
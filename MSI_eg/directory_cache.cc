@@ -0,0 +1,102 @@
+#include "learning_gem5/MSI_eg/directory_cache.hh"
+
+#include "base/logging.hh"
+#include "mem/ruby/system/RubySystem.hh"
+
+DirectoryCache::DirectoryCache(int entries, int assoc) :
+	numSets(assoc > 0 ? entries / assoc : 0),
+	assoc(assoc),
+	ways(entries > 0 ? entries : 0, Way{0, nullptr, 0}),
+	useCount(0)
+{
+	fatal_if(assoc <= 0, "directoryAssoc must be at least 1\n");
+	fatal_if(entries <= 0 || entries % assoc != 0,
+					 "directoryEntries must be a positive multiple of directoryAssoc\n");
+}
+
+DirectoryCache::~DirectoryCache()
+{
+	for(Way& way: ways)
+		delete way.entry;
+}
+
+DirectoryCache::Way* DirectoryCache::getSet(Addr addr)
+{
+	return &ways[(addr >> RubySystem::getBlockSizeBits()) % numSets * assoc];
+}
+
+const DirectoryCache::Way* DirectoryCache::getSet(Addr addr) const
+{
+	return &ways[(addr >> RubySystem::getBlockSizeBits()) % numSets * assoc];
+}
+
+DirectoryCache::Way* DirectoryCache::findWay(Addr addr)
+{
+	Way *set = getSet(addr);
+	for(unsigned i = 0; i < assoc; i++)
+	{
+		if(set[i].entry != nullptr && set[i].addr == addr)
+			return &set[i];
+	}
+	return nullptr;
+}
+
+AbstractEntry* DirectoryCache::lookup(Addr addr)
+{
+	Way *way = findWay(addr);
+	return way != nullptr ? way->entry : nullptr;
+}
+
+AbstractEntry* DirectoryCache::allocate(Addr addr, AbstractEntry *entry)
+{
+	assert(findWay(addr) == nullptr);
+	Way *set = getSet(addr);
+	for(unsigned i = 0; i < assoc; i++)
+	{
+		if(set[i].entry == nullptr)
+		{
+			set[i] = Way{addr, entry, ++useCount};
+			return entry;
+		}
+	}
+	panic("No free directory entry for addr %#x\n", addr);
+}
+
+void DirectoryCache::deallocate(Addr addr)
+{
+	Way *way = findWay(addr);
+	assert(way != nullptr);
+	delete way->entry;
+	way->entry = nullptr;
+}
+
+bool DirectoryCache::cacheAvail(Addr addr) const
+{
+	const Way *set = getSet(addr);
+	for(unsigned i = 0; i < assoc; i++)
+	{
+		if(set[i].entry == nullptr)
+			return true;
+	}
+	return false;
+}
+
+Addr DirectoryCache::cacheProbe(Addr addr) const
+{
+	const Way *set = getSet(addr);
+	const Way *victim = &set[0];
+	for(unsigned i = 1; i < assoc; i++)
+	{
+		if(set[i].lastUse < victim->lastUse)
+			victim = &set[i];
+	}
+	assert(victim->entry != nullptr);
+	return victim->addr;
+}
+
+void DirectoryCache::setMRU(Addr addr)
+{
+	Way *way = findWay(addr);
+	if(way != nullptr)
+		way->lastUse = ++useCount;
+}
@@ -0,0 +1,52 @@
+#ifndef __LEARNING_GEM5_MSI_EG_DIRECTORY_CACHE_HH__
+#define __LEARNING_GEM5_MSI_EG_DIRECTORY_CACHE_HH__
+
+#include <cstdint>
+#include <vector>
+
+#include "base/types.hh"
+#include "mem/ruby/slicc_interface/AbstractEntry.hh"
+
+//Bounded, set-associative store for the entries of the MSI directory (see MSI-dir.sm). It has the
+//subset of the CacheMemory interface the directory uses, but is sized by the directoryEntries and
+//directoryAssoc controller parameters, so a configuration does not have to build a RubyCache for it.
+//Replacement is LRU within a set. The store owns the entries it holds
+class DirectoryCache
+{
+	private:
+		struct Way
+		{
+			Addr addr;
+			//nullptr while the way is free
+			AbstractEntry *entry;
+			uint64_t lastUse;
+		};
+
+		const unsigned numSets;
+		const unsigned assoc;
+		//numSets * assoc ways, set i occupies [i*assoc, (i+1)*assoc)
+		std::vector<Way> ways;
+		uint64_t useCount;
+
+		Way *getSet(Addr addr);
+		const Way *getSet(Addr addr) const;
+		Way *findWay(Addr addr);
+
+	public:
+		DirectoryCache(int entries, int assoc);
+		~DirectoryCache();
+
+		//entry of a block, nullptr if it has none
+		AbstractEntry *lookup(Addr addr);
+		//addr must have no entry and its set a free way (cacheAvail)
+		AbstractEntry *allocate(Addr addr, AbstractEntry *entry);
+		void deallocate(Addr addr);
+
+		//true if the set of addr has a free way
+		bool cacheAvail(Addr addr) const;
+		//block to evict to make room for addr, only valid if cacheAvail is false
+		Addr cacheProbe(Addr addr) const;
+		void setMRU(Addr addr);
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "learning_gem5/MSI_eg/sharer_set.hh"
+
+#include <algorithm>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+
+SharerSet::SharerSet() :
+	numPointers(0),
+	usedPointers(0),
+	coarseness(1),
+	overflow(false)
+{
+	clear();
+}
+
+void SharerSet::setEncoding(int pointers, int coarse)
+{
+	fatal_if(pointers < 0 || pointers > MaxPointers,
+					 "sharerPointers must be between 0 and %d\n", MaxPointers);
+	fatal_if(coarse < 1, "sharerCoarseness must be at least 1\n");
+	fatal_if(pointers > 0 && coarse > 1,
+					 "Limited pointers and coarse vectors can not be combined\n");
+	fatal_if(pointers == 0 && divCeil(numCaches(), coarse) > MaxBits,
+					 "%d caches need a sharerCoarseness of at least %d\n",
+					 numCaches(), divCeil(numCaches(), MaxBits));
+
+	numPointers = pointers;
+	coarseness = coarse;
+	clear();
+}
+
+void SharerSet::add(const MachineID& id)
+{
+	panic_if(id.getType() != MachineType_L1Cache, "Only L1 caches can share a block\n");
+
+	if(numPointers)
+	{
+		if(overflow || isElement(id))
+			return;
+
+		if(usedPointers < numPointers)
+			pointers[usedPointers++] = id.getNum();
+		else
+			overflow = true;
+	}
+	else
+	{
+		int bit = id.getNum() / coarseness;
+		bits[bit / 64] |= 1ULL << (bit % 64);
+	}
+}
+
+void SharerSet::remove(const MachineID& id)
+{
+	if(numPointers)
+	{
+		if(overflow)
+			return;
+
+		uint16_t *end = pointers + usedPointers;
+		uint16_t *it = std::find(pointers, end, id.getNum());
+		if(it != end)
+		{
+			*it = pointers[usedPointers - 1];
+			usedPointers--;
+		}
+	}
+	else if(coarseness == 1)
+	{
+		bits[id.getNum() / 64] &= ~(1ULL << (id.getNum() % 64));
+	}
+}
+
+void SharerSet::clear()
+{
+	//also empties the pointers, which share the storage
+	std::fill(bits, bits + MaxBits / 64, 0);
+	usedPointers = 0;
+	overflow = false;
+}
+
+bool SharerSet::isElement(const MachineID& id) const
+{
+	if(id.getType() != MachineType_L1Cache)
+		return false;
+	if(overflow)
+		return true;
+	if(numPointers)
+		return std::find(pointers, pointers + usedPointers, id.getNum()) != pointers + usedPointers;
+
+	return testBit(id.getNum() / coarseness);
+}
+
+bool SharerSet::isExactElement(const MachineID& id) const
+{
+	if(overflow || (!numPointers && coarseness > 1))
+		return false;
+
+	return isElement(id);
+}
+
+int SharerSet::count() const
+{
+	if(overflow)
+		return numCaches();
+	if(numPointers)
+		return usedPointers;
+
+	int caches = 0;
+	forEach([&caches](NodeID) { caches++; });
+	return caches;
+}
+
+NetDest SharerSet::destinations() const
+{
+	NetDest dest;
+	forEach([&dest](NodeID node) { dest.add(MachineID{MachineType_L1Cache, node}); });
+	return dest;
+}
+
+NetDest SharerSet::destinationsExcept(const MachineID& id) const
+{
+	NetDest dest = destinations();
+	dest.remove(id);
+	return dest;
+}
+
+void SharerSet::print(std::ostream& out) const
+{
+	out << "[";
+	if(overflow)
+		out << " all";
+	else
+		forEach([&out](NodeID node) { out << " " << node; });
+	out << " ]";
+}
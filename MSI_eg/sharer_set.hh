@@ -0,0 +1,105 @@
+#ifndef __LEARNING_GEM5_MSI_EG_SHARER_SET_HH__
+#define __LEARNING_GEM5_MSI_EG_SHARER_SET_HH__
+
+#include <cstdint>
+#include <iostream>
+
+#include "mem/protocol/MachineType.hh"
+#include "mem/ruby/common/MachineID.hh"
+#include "mem/ruby/common/NetDest.hh"
+
+//The set of L1 caches a directory entry points at, in a fixed-size encoding instead of a NetDest,
+//which holds a bit vector per machine type on the heap. Three encodings are available:
+//
+// - full bit vector (the default): one bit per cache, exact
+// - limited pointers: up to N cache IDs are kept exactly. Adding one more sets an overflow bit, and
+//   from then on the set stands for every cache, so invalidations become a broadcast
+// - coarse vector: one bit per group of caches, and every cache of a marked group is a member
+//
+//The encodings share their storage, so a set is the size of the largest one, the bit vector, rather
+//than of all of them. The inexact encodings only ever over-approximate the set. count() and the destinations always
+//agree with each other, so the ack count a requestor is given matches the number of Invs sent.
+//Caches that receive an Inv for a block they do not hold simply ack it.
+class SharerSet
+{
+	public:
+		//Largest bit vector, so up to this many caches (or groups of caches) can be tracked
+		static const int MaxBits = 256;
+		static const int MaxPointers = 8;
+
+	private:
+		//Which member is in use depends on numPointers
+		union
+		{
+			uint64_t bits[MaxBits / 64];
+			uint16_t pointers[MaxPointers];
+		};
+
+		//Number of pointers, or 0 for a bit vector
+		uint8_t numPointers;
+		uint8_t usedPointers;
+		//Caches per bit of the vector, 1 for a full bit vector
+		uint16_t coarseness;
+		//Limited pointers ran out, every cache is a member
+		bool overflow;
+
+		static int numCaches() { return MachineType_base_count(MachineType_L1Cache); }
+
+		bool testBit(int bit) const { return bits[bit / 64] & (1ULL << (bit % 64)); }
+
+		//Call func(NodeID) for every cache in the set
+		template <typename F>
+		void forEach(F func) const
+		{
+			if(overflow)
+			{
+				for(int node = 0; node < numCaches(); node++)
+					func(node);
+			}
+			else if(numPointers)
+			{
+				for(int i = 0; i < usedPointers; i++)
+					func(pointers[i]);
+			}
+			else
+			{
+				for(int node = 0; node < numCaches(); node++)
+					if(testBit(node / coarseness))
+						func(node);
+			}
+		}
+
+	public:
+		SharerSet();
+
+		//Select the encoding, see the sharerPointers and sharerCoarseness parameters in MSI-dir.sm.
+		//Also empties the set
+		void setEncoding(int pointers, int coarse);
+
+		void add(const MachineID& id);
+		//Only exact encodings can forget a cache, otherwise the set is left as is
+		void remove(const MachineID& id);
+		void clear();
+
+		bool isElement(const MachineID& id) const;
+		//True only if the encoding tracks this cache exactly and it is a member
+		bool isExactElement(const MachineID& id) const;
+
+		//Number of caches invalidations are sent to
+		int count() const;
+		int countExcept(const MachineID& id) const { return count() - (isElement(id) ? 1 : 0); }
+
+		NetDest destinations() const;
+		NetDest destinationsExcept(const MachineID& id) const;
+
+		void print(std::ostream& out) const;
+};
+
+inline std::ostream&
+operator<<(std::ostream& out, const SharerSet& set)
+{
+	set.print(out);
+	return out;
+}
+
+#endif
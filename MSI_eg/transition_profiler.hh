@@ -0,0 +1,166 @@
+#ifndef __LEARNING_GEM5_MSI_EG_TRANSITION_PROFILER_HH__
+#define __LEARNING_GEM5_MSI_EG_TRANSITION_PROFILER_HH__
+
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "base/callback.hh"
+#include "base/output.hh"
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "mem/protocol/CoherenceRequestType.hh"
+#include "sim/core.hh"
+
+//Shows where a controller's blocks spend their time: how long they stay in each transient state, and
+//how long each request type holds a TBE. The counts per (state, event) pair are already kept by the
+//generated controller (the <Controller>.<State>.<Event> stats), and are only added to the dump.
+//Unlike CoherenceStats this depends on the machine's State and Event types, so each machine declares
+//it itself (see MSI-cache.sm) and calls stateChange() from its setState().
+template <class Controller, class State, class Event>
+class TransitionProfiler
+{
+	private:
+		//Every transient state in the MSI_eg protocols has an underscore in its name (IM_AD, S_D, MI_m),
+		//the stable ones (I, S, M, E, O, V) do not
+		static bool isTransient(const std::string& state) { return state.find('_') != std::string::npos; }
+
+		struct Samples
+		{
+			Stats::Histogram *hist;
+			uint64_t count;
+			uint64_t total;
+		};
+
+		Controller *controller;
+		const std::string name;
+		const int numStates;
+		const int numEvents;
+
+		//Indexed by state, hist is null for the stable states
+		std::vector<std::string> stateNames;
+		std::vector<Samples> residency;
+		//Indexed by request type
+		std::vector<Samples> latency;
+
+		//Blocks in a transient state, and requests waiting for their TBE to be freed
+		std::unordered_map<Addr, std::pair<int, Cycles>> entered;
+		std::unordered_map<Addr, std::pair<int, Cycles>> issued;
+
+		Samples makeSamples(const std::string& stat, const std::string& desc)
+		{
+			Stats::Histogram *hist = new Stats::Histogram();
+			hist->init(16)
+					 .name(name+"."+stat)
+					 .desc(desc)
+					 .flags(Stats::nozero);
+			return Samples{hist, 0, 0};
+		}
+
+		static void sample(Samples& s, Cycles cycles)
+		{
+			s.hist->sample(cycles);
+			s.count++;
+			s.total += cycles;
+		}
+
+		static void dumpSamples(std::ostream& os, const std::string& label, const Samples& s)
+		{
+			if(s.count)
+				os << " " << label << "=" << s.count << "/" << s.total / s.count;
+		}
+
+	public:
+		TransitionProfiler(Controller *_controller, const std::string& _name, int num_states,
+											 int num_events, bool dump_at_exit)
+			: controller(_controller), name(_name), numStates(num_states), numEvents(num_events)
+		{
+			for(int s = 0; s < numStates; s++)
+			{
+				std::ostringstream state;
+				state << static_cast<State>(s);
+				stateNames.push_back(state.str());
+
+				if(isTransient(state.str()))
+					residency.push_back(makeSamples("residency."+state.str(),
+																					"Cycles a block stayed in "+state.str()));
+				else
+					residency.push_back(Samples{nullptr, 0, 0});
+			}
+
+			for(int t = 0; t < CoherenceRequestType_NUM; t++)
+			{
+				std::ostringstream type;
+				type << static_cast<CoherenceRequestType>(t);
+				latency.push_back(makeSamples("latency."+type.str(),
+																			"Cycles from sending a "+type.str()+" to freeing its TBE"));
+			}
+
+			if(dump_at_exit)
+				registerExitCallback(new MakeCallback<TransitionProfiler, &TransitionProfiler::dump>(this));
+		}
+
+		void stateChange(Addr addr, State state)
+		{
+			Cycles now = controller->curCycle();
+			auto it = entered.find(addr);
+			if(it != entered.end())
+			{
+				if(it->second.first == state)
+					return;
+				sample(residency[it->second.first], now - it->second.second);
+				entered.erase(it);
+			}
+			if(residency[state].hist)
+				entered[addr] = std::make_pair(int(state), now);
+		}
+
+		//A request re-sent under the same TBE, like an Upgrade answered as a GetM, keeps the type and
+		//start cycle of the first one, so the latency covers the whole miss
+		void requestIssued(Addr addr, CoherenceRequestType type)
+		{
+			issued.emplace(addr, std::make_pair(int(type), controller->curCycle()));
+		}
+
+		void requestDone(Addr addr)
+		{
+			auto it = issued.find(addr);
+			if(it == issued.end())
+				return;
+			sample(latency[it->second.first], controller->curCycle() - it->second.second);
+			issued.erase(it);
+		}
+
+		//One entry per line of coherence_profile.txt in the output directory: the non-zero transition
+		//counts as State.Event=count, then the residencies and latencies as name=samples/mean cycles
+		void dump()
+		{
+			std::ostream& os = *simout.findOrCreate("coherence_profile.txt")->stream();
+			os << name << " transitions:";
+			for(int s = 0; s < numStates; s++)
+			{
+				for(int e = 0; e < numEvents; e++)
+				{
+					uint64_t count = controller->getTransitionCount(static_cast<State>(s), static_cast<Event>(e));
+					if(count)
+						os << " " << stateNames[s] << "." << static_cast<Event>(e) << "=" << count;
+				}
+			}
+			os << "\n" << name << " residency:";
+			for(int s = 0; s < numStates; s++)
+				dumpSamples(os, stateNames[s], residency[s]);
+			os << "\n" << name << " latency:";
+			for(int t = 0; t < CoherenceRequestType_NUM; t++)
+			{
+				std::ostringstream type;
+				type << static_cast<CoherenceRequestType>(t);
+				dumpSamples(os, type.str(), latency[t]);
+			}
+			os << "\n";
+			os.flush();
+		}
+};
+
+#endif
@@ -3,6 +3,15 @@ from m5.proxy import *
 from m5.SimObject import SimObject
 from MemObject import MemObject
 
+class BCReplPolicy(ScopedEnum):
+	vals = ['LRU', 'TreePLRU', 'SRRIP', 'BRRIP', 'Random']
+
+class BCPrefetcherType(ScopedEnum):
+	vals = ['None', 'NextLine', 'Stride', 'Stream']
+
+class BCWritePolicy(ScopedEnum):
+	vals = ['WriteBack', 'WriteNoAllocate', 'WriteThrough']
+
 class BlockingCache(MemObject):
 	type = 'BlockingCache'
 	cxx_header = 'learning_gem5/blocking_cache/blocking_cache.hh'
@@ -11,7 +20,35 @@ class BlockingCache(MemObject):
 	mem_side = MasterPort("Mem Side port, receives responses")
 
 	latency = Param.Cycles(1, "Cache Hit Latency or miss resolution latency")
+	banks = Param.Unsigned(1, "Number of address interleaved banks, each starts one access per cycle")
+	batch_accesses = Param.Bool(False, "Perform the accesses of all banks ready in a cycle from one event")
 
 	size = Param.MemorySize('128kB', "Size of cache memory")
+	assoc = Param.Unsigned(8, "Associativity of the cache")
+	sector_size = Param.Unsigned(0, "Bytes per sector with its own valid and dirty bits, misses are "
+		"answered once their sectors arrive and the rest of the block is filled behind them. 0 fills "
+		"whole blocks")
+
+	replacement_policy = Param.BCReplPolicy('LRU', "Policy used to choose eviction victims")
+	rrpv_bits = Param.Unsigned(2, "Bits of re-reference prediction per block for SRRIP/BRRIP")
+	brrip_btp = Param.Percent(3, "Percentage of BRRIP fills inserted with a long re-reference interval")
+
+	mshrs = Param.Unsigned(1, "Number of MSHRs (max outstanding misses), more than one makes the "
+		"cache non-blocking")
+	tgts_per_mshr = Param.Unsigned(1, "Max number of accesses per MSHR")
+
+	write_policy = Param.BCWritePolicy('WriteBack', "WriteBack allocates on write misses and writes back "
+		"dirty victims, WriteNoAllocate sends write misses to memory without filling the block, "
+		"WriteThrough also sends every write hit to memory and never dirties a block")
+	streaming_threshold = Param.Unsigned(0, "Sequential writes covering this many whole blocks in a row "
+		"stop write misses from allocating until the sequence breaks, 0 disables the detection")
+
+	clean_evict = Param.Bool(False, "Send CleanEvict for clean victims instead of dropping them")
+	write_buffers = Param.Unsigned(8, "Number of evictions which can wait for mem_side")
+
+	prefetcher = Param.BCPrefetcherType('None', "Hardware prefetcher, needs at least 2 mshrs")
+	prefetch_degree = Param.Unsigned(2, "Blocks prefetched per trigger")
+	prefetch_table_entries = Param.Unsigned(16, "Stride table entries or number of stream buffers")
+	prefetch_queue_size = Param.Unsigned(8, "Prefetch candidates waiting for an MSHR")
 
 	system = Param.System(Parent.any, "The system this cache is part of")
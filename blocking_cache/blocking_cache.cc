@@ -1,22 +1,84 @@
-#include "base/random.hh"
 #include "learning_gem5/blocking_cache/blocking_cache.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/bitfield.hh"
+#include "base/intmath.hh"
 #include "debug/BCache.hh"
+#include "sim/stats.hh"
 #include "sim/system.hh"
 
 BlockingCache::BlockingCache(BlockingCacheParams *params) :
 	MemObject(params), //Constructor invocation of parent class
 	latency(params->latency), //init of class members
 	blockSize(params->system->cacheLineSize()),
-	capacity(params->size / blockSize),
-	memPort(params->name + ".mem_side", this), //memory side master port
+	sectorSize(params->sector_size ? params->sector_size : blockSize),
+	numSectors(blockSize / sectorSize),
+	sectored(numSectors > 1),
+	allSectors(numSectors >= 64 ? ~0ULL : (1ULL << numSectors) - 1),
+	memPort(params->name + ".mem_side", this, params->write_buffers, blockSize), //memory side master port
+	numMSHRs(params->mshrs),
+	tgtsPerMSHR(params->tgts_per_mshr),
+	sendCleanEvict(params->clean_evict),
+	writeBuffers(params->write_buffers),
+	writePolicy(params->write_policy),
+	streamThreshold(params->streaming_threshold),
+	streamStart(0),
+	streamNextAddr(0),
+	streamFullBlocks(0),
+	numBanks(params->banks),
+	bankRetryEvent([this]{ processBankRetry(); }, name() + ".bankRetryEvent"),
+	batchAccesses(params->batch_accesses),
+	batchEvent([this]{ processBatch(); }, name() + ".batchEvent"),
+	inlineAccess(false),
+	inlineRespEvent([this]{ sendInlineResponses(); }, name() + ".inlineRespEvent"),
 	blocked(false),
-	pendingPkt(nullptr),
-	waitingPortID(-1)
+	mshrs(params->mshrs),
+	activeMSHRs(0),
+	accessesInFlight(0),
+	tags(params->size, blockSize, params->assoc,
+		BCReplacementPolicy::create(params->replacement_policy, params->rrpv_bits, params->brrip_btp)),
+	replPolicyName(BCReplacementPolicy::policyName(params->replacement_policy)),
+	prefetcher(BCPrefetcher::create(params->prefetcher, blockSize, params->prefetch_degree,
+		params->prefetch_table_entries)),
+	prefetchQueueSize(params->prefetch_queue_size),
+	lastMSHRUpdate(0),
+	wbStallStart(MaxTick)
 	{
+		fatal_if(numMSHRs == 0, "BlockingCache needs at least one MSHR\n");
+		fatal_if(writeBuffers == 0, "BlockingCache needs at least one write buffer entry\n");
+		fatal_if(numBanks == 0, "BlockingCache needs at least one bank\n");
+		fatal_if(!isPowerOf2(sectorSize) || sectorSize > blockSize,
+			"BlockingCache sector size must be a power of 2 no larger than a block\n");
+		fatal_if(numSectors > 64, "BlockingCache supports at most 64 sectors per block\n");
+
+		for(unsigned i=0; i<numBanks; i++)
+		{
+			banks.emplace_back(new Bank(latency + 1, [this, i]{ processBank(i); },
+				name() + csprintf(".bank[%d].event", i)));
+		}
+		inlineResponses.reserve(numBanks);
+		fatal_if(tgtsPerMSHR == 0, "BlockingCache needs at least one target per MSHR\n");
+
 		for(int i=0; i<params->port_cpu_side_connection_count; i++)
 		{
 			cpuPorts.emplace_back(name() + csprintf(".cpu_side[%d]", i), i, this); //cpu side slave port
 		}
+
+		//target lists are sized once, so that coalescing a miss never allocates
+		for(auto &mshr: mshrs)
+		{
+			mshr.valid = false;
+			mshr.isPrefetch = false;
+			mshr.targets.reserve(tgtsPerMSHR);
+			mshr.pendingFills = 0;
+			mshr.earlyResponses = 0;
+			mshr.earlyResponseTicks = 0;
+		}
+
+		if(prefetcher && numMSHRs < 2)
+			warn("%s: prefetches need at least 2 MSHRs, none will be issued\n", name());
 	}
 
 Port& BlockingCache::getPort(const std::string& if_name, PortID idx)
@@ -29,120 +91,836 @@ Port& BlockingCache::getPort(const std::string& if_name, PortID idx)
 		return SimObject::getPort(if_name, idx);
 }
 
-void BlockingCache::accessTiming(PacketPtr pkt)
+void BlockingCache::accessTiming(PacketPtr pkt, int port_id)
 {
-	bool hit = accessFunctional(pkt);//functional access, returns hit or miss; Performs appropriate cache operation
-	if(hit)
+	assert(accessesInFlight > 0);
+	accessesInFlight--;
+
+	if(crossesBlock(pkt))
+		accessSplit(pkt, port_id);
+	else
+		accessBlock(pkt, port_id);
+
+	tryDrainDone();
+}
+
+RequestPtr BlockingCache::pieceRequest(PacketPtr pkt, Addr addr, unsigned size) const
+{
+	const RequestPtr &req = pkt->req;
+	//the pieces keep the PC of the request, the prefetcher trains on it
+	if(req->hasPC())
+		return RequestPtr(new Request(addr, size, req->getFlags(), req->masterId(), req->getPC(),
+			req->hasContextId() ? req->contextId() : InvalidContextID));
+	return RequestPtr(new Request(addr, size, req->getFlags(), req->masterId()));
+}
+
+void BlockingCache::accessSplit(PacketPtr pkt, int port_id)
+{
+	panic_if(pkt->cmd != MemCmd::ReadReq && pkt->cmd != MemCmd::WriteReq,
+		"Only reads and writes can cross blocks, got %s\n", pkt->print());
+
+	//counted before the first piece is performed, a hit is answered right away
+	SplitAccess *access = new SplitAccess;
+	access->pkt = pkt;
+	access->portID = port_id;
+	access->piecesLeft = (pkt->getAddr() + pkt->getSize() - 1) / blockSize - pkt->getAddr() / blockSize + 1;
+	DPRINTF(BCache, "Splitting addr: %x size %d into %d pieces\n", pkt->getAddr(), pkt->getSize(),
+		access->piecesLeft);
+	splitRequests++;
+
+	//the pieces point into the data of pkt, reads fill it in place and writes take their bytes from it
+	uint8_t *data = pkt->getPtr<uint8_t>();
+	forEachPiece(pkt, [this, access, data, port_id](const RequestPtr &req, unsigned offset)
+	{
+		PacketPtr piece = new Packet(req, access->pkt->cmd);
+		piece->dataStatic(data + offset);
+		pendingPieces[piece] = access;
+		splitPieceAccesses++;
+		accessBlock(piece, port_id);
+	});
+}
+
+bool BlockingCache::completePiece(PacketPtr pkt)
+{
+	auto it = pendingPieces.find(pkt);
+	if(it == pendingPieces.end())
+		return false;
+
+	SplitAccess *access = it->second;
+	pendingPieces.erase(it);
+	delete pkt;
+	assert(access->piecesLeft > 0);
+	if(--access->piecesLeft > 0)
+		return true;
+
+	//every piece is done, the data of the request is complete
+	DPRINTF(BCache, "Split access for addr: %x complete\n", access->pkt->getAddr());
+	PacketPtr resp = access->pkt;
+	int port_id = access->portID;
+	delete access;
+	resp->makeResponse();
+	sendResponse(resp, port_id);
+	return true;
+}
+
+void BlockingCache::accessBlock(PacketPtr pkt, int port_id)
+{
+	//kept for the prefetcher, pkt may be answered and deleted before it is trained
+	Addr block_addr = pkt->getBlockAddr(blockSize);
+	RequestPtr req = pkt->req;
+
+	//first demand of a prefetched block, accessFunctional clears the flag
+	bool prefetch_hit = false;
+	if(prefetcher)
 	{
+		BCBlock *blk = tags.findBlock(block_addr);
+		prefetch_hit = blk != nullptr && blk->prefetched;
+	}
+
+	if(pkt->isWrite() && streamThreshold > 0)
+		trainStreamDetector(pkt);
+
+	bool hit;
+	if(bypassesCache(pkt))
+	{
+		//the write goes to memory, the cache at most updates its copy of the block
+		hit = handleWriteAround(pkt, port_id);
+		if(hit)
+			hits++;
+		else
+			misses++;
+	}
+	//functional access, returns hit or miss; Performs appropriate cache operation
+	else if((hit = !waitsOnFill(pkt) && accessFunctional(pkt)))
+	{
+		hits++;
 		pkt->makeResponse();//convert Req packet to Resp
-		sendResponse(pkt);//send packet to CPU side
+		sendResponse(pkt, port_id);//send packet to CPU side
 	}
 	else
 	{
-		missTime = curTick();
-		//cache miss
-		pendingPkt = pkt; //store the current req, later packets will get blocked
+		misses++;
+		handleMiss(pkt, port_id, curTick());
+	}
+
+	if(prefetcher)
+	{
+		notifyPrefetcher(block_addr, req, !hit || prefetch_hit);
+		issuePrefetches();
+	}
+}
+
+void BlockingCache::handleMiss(PacketPtr pkt, int port_id, Tick recv_time)
+{
+	Addr addr = pkt->getAddr();
+	Addr block_addr = pkt->getBlockAddr(blockSize);
+
+	//requests crossing blocks were split by accessTiming
+	assert(addr - block_addr + pkt->getSize() <= blockSize);
+
+	assert(pkt->needsResponse());
+
+	if(sectored)
+	{
+		handleSectoredMiss(pkt, port_id, recv_time);
+		return;
+	}
+
+	MSHR *mshr = findMSHR(block_addr);
+	if(mshr == nullptr && serviceFromWriteBuffer(pkt, port_id, recv_time))
+		return;
+
+	if(mshr != nullptr)
+	{
+		//block already being fetched, wait for the same fill unless the target list is full
+		if(mshr->targets.size() < tgtsPerMSHR)
+		{
+			DPRINTF(BCache, "Coalescing miss for addr: %x into MSHR\n", addr);
+			if(mshr->isPrefetch)
+			{
+				//the prefetch was right but did not arrive in time, the block now belongs to demand
+				latePrefetches++;
+				mshr->isPrefetch = false;
+			}
+			mshr->targets.push_back({pkt, port_id, recv_time});
+			mshrHits++;
+			if(mshr->targets.size() == tgtsPerMSHR)
+				targetFullBlocks++;
+			updateBlocked();
+			return;
+		}
+	}
+	else if(!writeBufferBlocked() && (mshr = allocateMSHR(block_addr)) != nullptr)
+	{
+		mshr->targets.push_back({pkt, port_id, recv_time});
+
+		//construct a block sized read, the original request is answered from the cache once the
+		//fill arrives. A write request will read and make it dirty
+		MemCmd cmd;
+		if(pkt->isWrite() || pkt->isRead())
+			cmd = MemCmd::ReadReq;
+		else
+			panic("Unknown packet type\n");
+
+		DPRINTF(BCache, "Allocated MSHR for addr: %x, %d in use\n", block_addr, activeMSHRs);
+		PacketPtr new_pkt = new Packet(pkt->req, cmd, blockSize);
+		new_pkt->allocate();
+
+		//send the newly constructed packet to memory
+		memPort.sendPacket(new_pkt);
+		if(activeMSHRs == numMSHRs)
+			mshrFullBlocks++;
+		updateBlocked();
+		return;
+	}
+
+	//no MSHR, target or write buffer entry available. This request was already in the access pipeline
+	//when the cache blocked, hold it until an MSHR is freed or the write buffer drains
+	DPRINTF(BCache, "No MSHR available for addr: %x, deferring\n", addr);
+	deferredTargets.push_back({pkt, port_id, recv_time});
+	updateBlocked();
+}
+
+uint64_t BlockingCache::sectorMask(Addr offset, unsigned size) const
+{
+	unsigned first = offset / sectorSize;
+	unsigned last = (offset + size - 1) / sectorSize;
+	//2 << 63 wraps to 0, which still gives every bit up to 63
+	return ((2ULL << last) - 1) & ~((1ULL << first) - 1);
+}
+
+bool BlockingCache::sectorsValid(const BCBlock *blk, PacketPtr pkt) const
+{
+	uint64_t sectors = sectorMask(pkt->getAddr() - blk->tag, pkt->getSize());
+	return (blk->validSectors & sectors) == sectors;
+}
+
+bool BlockingCache::waitsOnFill(PacketPtr pkt)
+{
+	if(!sectored)
+		return false;
+	Addr block_addr = pkt->getBlockAddr(blockSize);
+	MSHR *mshr = findMSHR(block_addr);
+	if(mshr == nullptr)
+		return false;
+
+	uint64_t sectors = sectorMask(pkt->getAddr() - block_addr, pkt->getSize());
+	for(auto &target: mshr->targets)
+	{
+		if(sectorMask(target.pkt->getAddr() - block_addr, target.pkt->getSize()) & sectors)
+			return true;
+	}
+	return false;
+}
+
+void BlockingCache::handleSectoredMiss(PacketPtr pkt, int port_id, Tick recv_time)
+{
+	Addr addr = pkt->getAddr();
+	Addr block_addr = pkt->getBlockAddr(blockSize);
+
+	MSHR *mshr = findMSHR(block_addr);
+	if(mshr == nullptr && serviceFromWriteBuffer(pkt, port_id, recv_time))
+		return;
+
+	if(mshr != nullptr)
+	{
+		//the block is pinned while it fills, every sector it misses has a read in flight
+		BCBlock *blk = tags.findBlock(block_addr);
+		assert(blk != nullptr && blk->filling);
+		if(writeFullSectors(blk, mshr, pkt))
+		{
+			missLatency.sample(curTick() - recv_time);
+			pkt->makeResponse();
+			sendResponse(pkt, port_id);
+			return;
+		}
+
+		if(mshr->targets.size() < tgtsPerMSHR)
+		{
+			DPRINTF(BCache, "Coalescing miss for addr: %x into MSHR\n", addr);
+			if(mshr->isPrefetch)
+			{
+				latePrefetches++;
+				mshr->isPrefetch = false;
+				blk->prefetched = false;
+			}
+			mshr->targets.push_back({pkt, port_id, recv_time});
+			mshrHits++;
+			if(mshr->targets.size() == tgtsPerMSHR)
+				targetFullBlocks++;
+			updateBlocked();
+			return;
+		}
+	}
+	else if(!writeBufferBlocked() && activeMSHRs < numMSHRs)
+	{
+		BCBlock *blk = allocateFillingBlock(block_addr);
+		if(blk != nullptr)
+		{
+			bool written = writeFullSectors(blk, nullptr, pkt);
+			if(written)
+			{
+				missLatency.sample(curTick() - recv_time);
+				pkt->makeResponse();
+				sendResponse(pkt, port_id);
+				//the write covered the whole block, there is nothing left to fetch
+				if(blk->validSectors == allSectors)
+				{
+					blk->filling = false;
+					updateBlocked();
+					return;
+				}
+			}
+
+			mshr = allocateMSHR(block_addr);
+			assert(mshr != nullptr);
+			if(!written)
+				mshr->targets.push_back({pkt, port_id, recv_time});
+
+			DPRINTF(BCache, "Allocated MSHR for addr: %x, %d in use\n", block_addr, activeMSHRs);
+			sendSectorFills(mshr, blk, written ? 0 : sectorMask(addr - block_addr, pkt->getSize()));
+			if(activeMSHRs == numMSHRs)
+				mshrFullBlocks++;
+			updateBlocked();
+			return;
+		}
+		sectorVictimStalls++;
+	}
+
+	DPRINTF(BCache, "No MSHR available for addr: %x, deferring\n", addr);
+	deferredTargets.push_back({pkt, port_id, recv_time});
+	updateBlocked();
+}
+
+BCBlock* BlockingCache::allocateFillingBlock(Addr block_addr)
+{
+	BCBlock *blk = tags.findVictim(block_addr);
+	if(blk == nullptr)
+		return nullptr;
+
+	if(blk->valid)
+		evict(blk);
+	tags.insertBlock(blk, block_addr);
+	blk->validSectors = 0;
+	blk->filling = true;
+	return blk;
+}
+
+bool BlockingCache::writeFullSectors(BCBlock *blk, MSHR *mshr, PacketPtr pkt)
+{
+	Addr offset = pkt->getAddr() - blk->tag;
+	if(!pkt->isWrite() || offset % sectorSize != 0 || pkt->getSize() % sectorSize != 0)
+		return false;
+
+	uint64_t sectors = sectorMask(offset, pkt->getSize());
+	//an older request waiting for one of these sectors has to see it before this write
+	if(mshr != nullptr)
+	{
+		for(auto &target: mshr->targets)
+		{
+			if(sectorMask(target.pkt->getAddr() - blk->tag, target.pkt->getSize()) & sectors)
+				return false;
+		}
+	}
+
+	DPRINTF(BCache, "Whole sector write for addr: %x, not fetched\n", pkt->getAddr());
+	pkt->writeDataToBlock(blk->data, blockSize);
+	blk->validSectors |= sectors;
+	blk->dirtySectors |= sectors;
+	blk->dirty = true;
+	tags.touch(blk);
+	writeAllocNoFetch++;
+	//with a fill in flight the sectors were requested already
+	if(mshr == nullptr)
+		fetchBytesAvoided += pkt->getSize();
+	return true;
+}
+
+void BlockingCache::sendSectorFill(MSHR *mshr, uint64_t sectors)
+{
+	unsigned first = findLsbSet(sectors);
+	unsigned count = popCount(sectors);
+	assert(count == 64 || sectors >> first == (1ULL << count) - 1);
+
+	RequestPtr req(new Request(mshr->blockAddr + first * sectorSize, count * sectorSize, 0, 0));
+	PacketPtr new_pkt = new Packet(req, MemCmd::ReadReq);
+	new_pkt->allocate();
+	memPort.sendPacket(new_pkt);
+	mshr->pendingFills++;
+	sectorFills++;
+}
+
+void BlockingCache::sendSectorFills(MSHR *mshr, BCBlock *blk, uint64_t critical)
+{
+	//the sectors of the request go first, it is answered as soon as they arrive
+	if(critical != 0)
+		sendSectorFill(mshr, critical);
+
+	//then the rest of the block in the background, one read per run of missing sectors
+	uint64_t rest = allSectors & ~blk->validSectors & ~critical;
+	unsigned first = 0;
+	while(first < numSectors)
+	{
+		if(!(rest & (1ULL << first)))
+		{
+			first++;
+			continue;
+		}
+		unsigned end = first;
+		while(end < numSectors && (rest & (1ULL << end)))
+			end++;
+		sendSectorFill(mshr, sectorMask(first * sectorSize, (end - first) * sectorSize));
+		first = end;
+	}
+}
+
+void BlockingCache::fillSectors(MSHR *mshr, PacketPtr pkt)
+{
+	BCBlock *blk = tags.findBlock(mshr->blockAddr);
+	assert(blk != nullptr && blk->filling);
+
+	//sectors written by the CPU while the read was in flight are newer than memory, keep them
+	Addr offset = pkt->getAddr() - mshr->blockAddr;
+	uint64_t arrived = sectorMask(offset, pkt->getSize()) & ~blk->validSectors;
+	const uint8_t *data = pkt->getConstPtr<uint8_t>();
+	for(unsigned i=0; i<numSectors; i++)
+	{
+		if(arrived & (1ULL << i))
+			std::memcpy(blk->data + i * sectorSize, data + i * sectorSize - offset, sectorSize);
+	}
+	blk->validSectors |= arrived;
+	assert(mshr->pendingFills > 0);
+	mshr->pendingFills--;
+	bool complete = mshr->pendingFills == 0;
+
+	//answer, in order, the targets whose sectors are all there. A target which still waits holds
+	//back the younger ones touching its sectors
+	uint64_t waiting = 0;
+	unsigned kept = 0;
+	for(unsigned i=0; i<mshr->targets.size(); i++)
+	{
+		Target &target = mshr->targets[i];
+		uint64_t sectors = sectorMask(target.pkt->getAddr() - mshr->blockAddr, target.pkt->getSize());
+		if((sectors & ~blk->validSectors) || (sectors & waiting))
+		{
+			waiting |= sectors;
+			mshr->targets[kept++] = target;
+			continue;
+		}
+
+		missLatency.sample(curTick() - target.recvTime);
+		bool hit = accessFunctional(target.pkt);
+		assert(hit);
+		target.pkt->makeResponse();
+		sendResponse(target.pkt, target.portID);
+		if(!complete)
+		{
+			criticalFirstResponses++;
+			mshr->earlyResponses++;
+			mshr->earlyResponseTicks += curTick();
+		}
+	}
+	mshr->targets.erase(mshr->targets.begin() + kept, mshr->targets.end());
+
+	if(complete)
+	{
+		assert(mshr->targets.empty());
+		DPRINTF(BCache, "Block %x complete\n", mshr->blockAddr);
+		blk->filling = false;
+		//the early targets would otherwise have been answered now
+		firstUseSavedTicks += mshr->earlyResponses * curTick() - mshr->earlyResponseTicks;
+		freeMSHR(mshr);
+	}
+}
+
+void BlockingCache::trainStreamDetector(PacketPtr pkt)
+{
+	Addr addr = pkt->getAddr();
+	if(addr != streamNextAddr)
+	{
+		//out of sequence, the stream (if any) is over and a new run may start here
+		DPRINTF(BCache, "Write run broken at addr: %x after %d blocks\n", addr, streamFullBlocks);
+		streamStart = addr;
+		streamFullBlocks = 0;
+	}
+	streamNextAddr = addr + pkt->getSize();
 
-		Addr addr = pkt->getAddr();
-		Addr block_addr = pkt->getBlockAddr(blockSize);
-		unsigned size = pkt->getSize(); 
-		
-		//if the request has the same size as that of cache block size, same packet can be forwarded
-		if(addr == block_addr && size == blockSize)
+	//the run wrote a whole block once it reaches the end of a block it started at or before
+	if(streamNextAddr % blockSize == 0 && streamNextAddr - blockSize >= streamStart)
+	{
+		streamFullBlocks++;
+		if(streamFullBlocks == streamThreshold)
 		{
-			DPRINTF(BCache, "Forwarding packet\n");
-			memPort.sendPacket(pkt);
+			DPRINTF(BCache, "Streaming writes detected at addr: %x\n", addr);
+			streamsDetected++;
 		}
-		else //cache miss, request size < blockSize, creating new pkt without modifying old one
-		{		 //and sending the new packet to memPort, will send the old packet to CPU side once
-				 //response is received
-			DPRINTF(BCache, "Req size less than block size, upgrading\n");
+	}
+}
+
+bool BlockingCache::bypassesCache(PacketPtr pkt)
+{
+	if(!pkt->isWrite() || (writePolicy == BCWritePolicy::WriteBack && !streaming()))
+		return false;
+
+	Addr block_addr = pkt->getBlockAddr(blockSize);
+	if(findMSHR(block_addr) != nullptr)
+		return false;
+	if(writePolicy == BCWritePolicy::WriteThrough)
+		return true;
 
-			//the case when a single request spans multiple cache blocks, not allowed
-			panic_if(addr - block_addr + size > blockSize, "Req cannot span multiple blocks\n");
+	//not allocating only matters to misses, a write hit dirties the block as usual
+	BCBlock *blk = tags.findBlock(block_addr);
+	return blk == nullptr || !sectorsValid(blk, pkt);
+}
+
+bool BlockingCache::handleWriteAround(PacketPtr pkt, int port_id)
+{
+	Addr block_addr = pkt->getBlockAddr(blockSize);
+	BCBlock *blk = tags.findBlock(block_addr);
+	bool hit = blk != nullptr && sectorsValid(blk, pkt);
 
-			assert(pkt->needsResponse());
+	if(hit)
+	{
+		//memory gets the write as well, the block stays as clean as it was
+		bool dirty = blk->dirty;
+		uint64_t dirty_sectors = blk->dirtySectors;
+		accessFunctional(pkt);
+		blk->dirty = dirty;
+		blk->dirtySectors = dirty_sectors;
+	}
+	else if(writePolicy == BCWritePolicy::WriteBack)
+		streamingWrites++;
 
-			//construct the new packet to be sent to the memory
-			MemCmd cmd;
-			if(pkt->isWrite() || pkt->isRead())//a write request will read and make it dirty
-				cmd = MemCmd::ReadReq;
-			else
-				panic("Unknown packet type\n");
+	//an eviction of the block still in the write buffer is older than this write, it has to reach
+	//memory first
+	PacketPtr wb_pkt;
+	while((wb_pkt = memPort.extractWriteback(block_addr)) != nullptr)
+		memPort.sendPacket(wb_pkt);
 
-			PacketPtr new_pkt = new Packet(pkt->req, cmd, blockSize);
-			new_pkt->allocate();
-			pendingPkt = pkt;
+	//the write itself goes to memory like a fill, and is answered when memory answers it
+	assert(pkt->needsResponse());
+	DPRINTF(BCache, "Forwarding write: %s\n", pkt->print());
+	forwardedWrites[pkt] = port_id;
+	memPort.sendPacket(pkt);
+	writesForwarded++;
+	writeForwardBytes += pkt->getSize();
+	return hit;
+}
+
+bool BlockingCache::serviceFromWriteBuffer(PacketPtr pkt, int port_id, Tick recv_time)
+{
+	PacketPtr wb_pkt = memPort.extractWriteback(pkt->getBlockAddr(blockSize));
+	if(wb_pkt == nullptr)
+		return false;
+
+	if(!wb_pkt->hasData())
+	{
+		//a CleanEvict only announces the eviction, memory still has the data
+		delete wb_pkt;
+		return false;
+	}
 
-			//send the newly constructed packet to memory
-			memPort.sendPacket(new_pkt);
+	//the buffered data is newer than memory, put it back into the cache as it was. The slot it used
+	//is free again, so the eviction this fill may cause fits in the write buffer. In a sectored cache
+	//every way of the set may be pinned by a fill, the writeback then goes to memory ahead of the
+	//fill of the miss instead
+	BCBlock *blk = insert(wb_pkt);
+	if(blk == nullptr)
+	{
+		memPort.sendPacket(wb_pkt);
+		return false;
+	}
+	DPRINTF(BCache, "Write buffer hit for addr: %x\n", pkt->getAddr());
+	blk->dirty = true;
+	blk->dirtySectors = allSectors;
+	delete wb_pkt;
+	writeBufferHits++;
+
+	bool hit = accessFunctional(pkt);
+	assert(hit);
+	missLatency.sample(curTick() - recv_time);
+	pkt->makeResponse();
+	sendResponse(pkt, port_id);
+	return true;
+}
+
+void BlockingCache::notifyPrefetcher(Addr block_addr, const RequestPtr &req, bool miss)
+{
+	Addr pc = req->hasPC() ? req->getPC() : 0;
+	prefetchCandidates.clear();
+	prefetcher->notify(block_addr, pc, req->hasPC(), miss, prefetchCandidates);
+
+	for(Addr addr: prefetchCandidates)
+	{
+		//already present, queued or fetched, or no room left
+		if(tags.findBlock(addr) != nullptr || findMSHR(addr) != nullptr ||
+			std::find(prefetchQueue.begin(), prefetchQueue.end(), addr) != prefetchQueue.end() ||
+			prefetchQueue.size() >= prefetchQueueSize)
+		{
+			prefetchesDropped++;
+			continue;
+		}
+		prefetchQueue.push_back(addr);
+	}
+}
+
+void BlockingCache::issuePrefetches()
+{
+	//a drain has to finish, no new transfers
+	if(drainState() != DrainState::Running)
+	{
+		prefetchQueue.clear();
+		return;
+	}
+
+	//the MSHR, and the write buffer slot reserved for its victim, must leave one of each for demand
+	while(!prefetchQueue.empty() && activeMSHRs + 1 < numMSHRs &&
+		memPort.writeBufferFree() > activeMSHRs + 1)
+	{
+		Addr addr = prefetchQueue.front();
+		prefetchQueue.pop_front();
+
+		//the block may have been filled, demanded or evicted to the write buffer since it was queued
+		if(tags.findBlock(addr) != nullptr || findMSHR(addr) != nullptr ||
+			memPort.hasWriteback(addr))
+		{
+			prefetchesDropped++;
+			continue;
 		}
+
+		//a sectored cache allocates the block now, the set may have no way left to pin
+		BCBlock *blk = sectored ? allocateFillingBlock(addr) : nullptr;
+		if(sectored && blk == nullptr)
+		{
+			prefetchesDropped++;
+			continue;
+		}
+
+		MSHR *mshr = allocateMSHR(addr);
+		assert(mshr != nullptr);
+		mshr->isPrefetch = true;
+
+		DPRINTF(BCache, "Prefetching addr: %x\n", addr);
+		prefetchesIssued++;
+		if(sectored)
+		{
+			blk->prefetched = true;
+			sendSectorFill(mshr, allSectors);
+			continue;
+		}
+		RequestPtr req(new Request(addr, blockSize, 0, 0));
+		PacketPtr new_pkt = new Packet(req, MemCmd::ReadReq);
+		new_pkt->allocate();
+		memPort.sendPacket(new_pkt);
+	}
+}
+
+BlockingCache::MSHR* BlockingCache::findMSHR(Addr block_addr)
+{
+	for(auto &mshr: mshrs)
+	{
+		if(mshr.valid && mshr.blockAddr == block_addr)
+			return &mshr;
+	}
+	return nullptr;
+}
+
+BlockingCache::MSHR* BlockingCache::allocateMSHR(Addr block_addr)
+{
+	for(auto &mshr: mshrs)
+	{
+		if(!mshr.valid)
+		{
+			updateMSHRTicks();
+			mshr.valid = true;
+			mshr.blockAddr = block_addr;
+			assert(mshr.targets.empty());
+			activeMSHRs++;
+			mshrOccupancy.sample(activeMSHRs);
+			return &mshr;
+		}
+	}
+	return nullptr;
+}
+
+void BlockingCache::freeMSHR(MSHR *mshr)
+{
+	assert(mshr->valid);
+	updateMSHRTicks();
+	mshr->valid = false;
+	mshr->isPrefetch = false;
+	mshr->targets.clear();
+	mshr->pendingFills = 0;
+	mshr->earlyResponses = 0;
+	mshr->earlyResponseTicks = 0;
+	activeMSHRs--;
+}
+
+void BlockingCache::updateMSHRTicks()
+{
+	Tick delta = curTick() - lastMSHRUpdate;
+	if(activeMSHRs > 0)
+	{
+		outstandingMissTicks += delta * activeMSHRs;
+		missBusyTicks += delta;
+	}
+	lastMSHRUpdate = curTick();
+}
+
+void BlockingCache::updateBlocked()
+{
+	bool was_blocked = blocked;
+
+	blocked = !deferredTargets.empty() || activeMSHRs == numMSHRs;
+	for(auto &mshr: mshrs)
+	{
+		if(mshr.valid && mshr.targets.size() >= tgtsPerMSHR)
+			blocked = true;
+	}
+
+	//blocked on the write buffer alone, MSHRs are still free
+	bool wb_stall = writeBufferBlocked() && activeMSHRs < numMSHRs;
+	blocked = blocked || wb_stall;
+	if(wb_stall && wbStallStart == MaxTick)
+		wbStallStart = curTick();
+	else if(!wb_stall && wbStallStart != MaxTick)
+	{
+		writeBufferStallCycles += ticksToCycles(curTick() - wbStallStart);
+		wbStallStart = MaxTick;
+	}
+
+	//the cache can accept requests again, let the ports which were turned down retry
+	if(was_blocked && !blocked)
+	{
+		for(auto &port: cpuPorts)
+			port.trySendRetry();
 	}
 }
 
 bool BlockingCache::accessFunctional(PacketPtr pkt)
 {
 	Addr block_addr = pkt->getBlockAddr(blockSize);
-	auto it = cacheStore.find(block_addr);
+	BCBlock *blk = tags.findBlock(block_addr);
 
-	if(it != cacheStore.end())//cache hit
+	if(blk != nullptr && sectorsValid(blk, pkt))//cache hit, every sector needed is there
 	{
-		hits++;
-		if(pkt->isWrite())//write request: copy data from pkt to cacheStorage
-			pkt->writeDataToBlock(it->second, blockSize);
+		tags.touch(blk);
+		if(blk->prefetched)
+		{
+			usefulPrefetches++;
+			blk->prefetched = false;
+		}
+		if(pkt->isWrite())//write request: copy data from pkt to cacheStorage, block now differs from memory
+		{
+			pkt->writeDataToBlock(blk->data, blockSize);
+			blk->dirty = true;
+			blk->dirtySectors |= sectorMask(pkt->getAddr() - block_addr, pkt->getSize());
+		}
 		else if(pkt->isRead())// read request: copy data from cacheStorage to pkt
-			pkt->setDataFromBlock(it->second, blockSize);
+			pkt->setDataFromBlock(blk->data, blockSize);
 		else
 			DPRINTF(BCache, "Unknown packet type!");
 		return true;
 	}
-	misses++;
 	return false;//cache miss
 }
 
-void BlockingCache::insert(PacketPtr pkt)
+BCBlock* BlockingCache::insert(PacketPtr pkt, bool atomic)
 {
-	if(cacheStore.size() >= capacity)//cache full, evict block
-	{
-		int bucket, bucket_size;
-		do
-		{
-			bucket = random_mt.random(0, (int)cacheStore.bucket_count()-1);
-		} while ( (bucket_size = cacheStore.bucket_size(bucket)) == 0);
-		
-		auto block = std::next(cacheStore.begin(bucket), random_mt.random(0, bucket_size-1));
+	Addr block_addr = pkt->getAddr();
+	BCBlock *blk = tags.findVictim(block_addr);
+	//every way is pinned by a sector fill
+	if(blk == nullptr)
+		return nullptr;
+
+	if(blk->valid)//set full, evict block
+		evict(blk, atomic);
+
+	//the block's storage lives in the tag array's arena, copy the fill into it. A fill is clean
+	tags.insertBlock(blk, block_addr);
+	pkt->writeDataToBlock(blk->data, blockSize);
+	return blk;
+}
 
-		//prepare new request packet to write back data to memory, resulting from eviction
-		RequestPtr req(new Request(block->first, blockSize, 0, 0));
+void BlockingCache::evict(BCBlock *blk, bool atomic)
+{
+	assert(blk->valid);
+	replacements++;
+	if(blk->prefetched)
+		uselessPrefetches++;
+
+	if(blk->dirty)
+	{
+		//prepare new request packet to write back data to memory, resulting from eviction. The block
+		//is reused for the fill right away, so its data has to be copied into the packet. Writebacks
+		//are whole blocks, whatever sectors are dirty, as the memory side expects
+		RequestPtr req(new Request(blk->tag, blockSize, 0, 0));
 		PacketPtr new_pkt = new Packet(req, MemCmd::WritebackDirty, blockSize);
-		new_pkt->dataDynamic(block->second);
+		new_pkt->allocate();
+		new_pkt->setData(blk->data);
 
-		DPRINTF(BCache, "Write back dirty packet: %s\n", pkt->print());
-		//send dirty packet to memory
-		memPort.sendTimingReq(new_pkt);
+		DPRINTF(BCache, "Write back dirty packet: %s\n", new_pkt->print());
+		if(atomic)
+		{
+			//the writeback is off the critical path, its latency is not charged to the access
+			memPort.sendAtomic(new_pkt);
+			delete new_pkt;
+		}
+		else
+		{
+			//queue dirty packet for memory
+			memPort.sendWriteback(new_pkt);
+			writeBufferOccupancy.sample(memPort.writeBufferOccupancy());
+		}
 
-		//delete packet from cacheStorage
-		cacheStore.erase(block->first);
+		dirtyEvictions++;
+		writebackBytes += blockSize;
 	}
+	else
+	{
+		//memory already has this data. Drop it, or just tell the memory side it is gone
+		cleanEvictions++;
+		if(sendCleanEvict && !atomic)
+		{
+			RequestPtr req(new Request(blk->tag, blockSize, 0, 0));
+			PacketPtr new_pkt = new Packet(req, MemCmd::CleanEvict);
 
-	//insert packet into cacheStorage. The map contains only pointer, space for data is allocated
-	//dynamically, and will be cleared once it is written back to main memory or evicted cleanly
-	uint8_t *data = new uint8_t[blockSize];
-	cacheStore[pkt->getAddr()] = data; //insert pointer into hashmap
+			DPRINTF(BCache, "Clean evict packet: %s\n", new_pkt->print());
+			memPort.sendWriteback(new_pkt);
+			writeBufferOccupancy.sample(memPort.writeBufferOccupancy());
+		}
+		else
+			DPRINTF(BCache, "Dropping clean block %x\n", blk->tag);
+	}
 
-	pkt->writeDataToBlock(data, blockSize); //copies data in pointer to new cache block
+	tags.invalidate(blk);
 }
 
-void BlockingCache::sendResponse(PacketPtr pkt)
+void BlockingCache::sendResponse(PacketPtr pkt, int port_id)
 {
-	int port = waitingPortID;
+	//a piece of a split request, merged into it rather than sent
+	if(!pendingPieces.empty() && completePiece(pkt))
+		return;
 
-	blocked = false;
-	waitingPortID = -1;
-	//data response available in pkt, unblock and send packet to CPUSidePort
-	cpuPorts[port].sendPacket(pkt);
-	for(auto port: cpuPorts)
-		port.trySendRetry();
+	//still inside recvTimingReq, the response has to wait until the master is done sending
+	if(inlineAccess)
+	{
+		inlineResponses.push_back(std::make_pair(pkt, port_id));
+		if(!inlineRespEvent.scheduled())
+			schedule(inlineRespEvent, curTick());
+		return;
+	}
+
+	//data response available in pkt, send packet to the CPUSidePort it came from
+	cpuPorts[port_id].sendPacket(pkt);
+}
+
+void BlockingCache::sendInlineResponses()
+{
+	for(auto &resp: inlineResponses)
+		cpuPorts[resp.second].sendPacket(resp.first);
+	inlineResponses.clear();
+	tryDrainDone();
 }
 
 AddrRangeList CPUSidePort::getAddrRanges() const
@@ -155,11 +933,205 @@ void CPUSidePort::recvFunctional(PacketPtr pkt)
 	owner->handleFunctional(pkt);
 }
 
+Tick CPUSidePort::recvAtomic(PacketPtr pkt)
+{
+	return owner->handleAtomic(pkt);
+}
+
 void BlockingCache::handleFunctional(PacketPtr pkt)
 {
+	//one functional access per block, the pieces read into or write from the data of pkt
+	if(crossesBlock(pkt))
+	{
+		uint8_t *data = pkt->getPtr<uint8_t>();
+		forEachPiece(pkt, [this, pkt, data](const RequestPtr &req, unsigned offset)
+		{
+			Packet piece(req, pkt->cmd);
+			piece.dataStatic(data + offset);
+			handleFunctional(&piece);
+		});
+		if(pkt->needsResponse())
+			pkt->makeResponse();
+		return;
+	}
+
+	//a cached block may be newer than memory. Reads are answered from it, writes update it and
+	//then go on to memory as well
+	BCBlock *blk = tags.findBlock(pkt->getBlockAddr(blockSize));
+	if(blk != nullptr && pkt->isRead() && !sectorsValid(blk, pkt))
+	{
+		//part of the read is still being filled. Memory has those bytes, the sectors which are
+		//there already may be newer
+		if(!memPort.trySatisfyFunctional(pkt))
+			memPort.sendFunctional(pkt);
+		Addr offset = pkt->getAddr() - blk->tag;
+		uint64_t sectors = sectorMask(offset, pkt->getSize()) & blk->validSectors;
+		for(unsigned i=0; i<numSectors; i++)
+		{
+			if(!(sectors & (1ULL << i)))
+				continue;
+			Addr start = std::max<Addr>(offset, i * sectorSize);
+			Addr end = std::min<Addr>(offset + pkt->getSize(), (i + 1) * sectorSize);
+			std::memcpy(pkt->getPtr<uint8_t>() + start - offset, blk->data + start, end - start);
+		}
+		return;
+	}
+	if(blk != nullptr)
+	{
+		if(pkt->isRead())
+		{
+			pkt->setDataFromBlock(blk->data, blockSize);
+			pkt->makeResponse();
+			return;
+		}
+		else if(pkt->isWrite())
+			pkt->writeDataToBlock(blk->data, blockSize);
+	}
+
+	//data still in the write buffer is newer than memory
+	if(memPort.trySatisfyFunctional(pkt))
+		return;
 	memPort.sendFunctional(pkt);
 }
 
+Tick BlockingCache::handleAtomic(PacketPtr pkt)
+{
+	//one access per block, performed in parallel so the slowest piece sets the latency
+	if(crossesBlock(pkt))
+	{
+		panic_if(pkt->cmd != MemCmd::ReadReq && pkt->cmd != MemCmd::WriteReq,
+			"Only reads and writes can cross blocks, got %s\n", pkt->print());
+		Tick lat = 0;
+		uint8_t *data = pkt->getPtr<uint8_t>();
+		forEachPiece(pkt, [this, pkt, data, &lat](const RequestPtr &req, unsigned offset)
+		{
+			Packet piece(req, pkt->cmd);
+			piece.dataStatic(data + offset);
+			splitPieceAccesses++;
+			lat = std::max(lat, handleAtomic(&piece));
+		});
+		splitRequests++;
+		if(pkt->needsResponse())
+			pkt->makeResponse();
+		return lat;
+	}
+
+	Addr block_addr = pkt->getBlockAddr(blockSize);
+	Tick lat = cyclesToTicks(latency);
+
+	if(pkt->isWrite() && streamThreshold > 0)
+		trainStreamDetector(pkt);
+
+	if(bypassesCache(pkt))
+	{
+		//the write goes on to memory, a cached copy is updated without being dirtied
+		BCBlock *blk = tags.findBlock(block_addr);
+		if(blk != nullptr && sectorsValid(blk, pkt))
+		{
+			hits++;
+			bool dirty = blk->dirty;
+			uint64_t dirty_sectors = blk->dirtySectors;
+			accessFunctional(pkt);
+			blk->dirty = dirty;
+			blk->dirtySectors = dirty_sectors;
+		}
+		else
+		{
+			misses++;
+			if(writePolicy == BCWritePolicy::WriteBack)
+				streamingWrites++;
+		}
+		writesForwarded++;
+		writeForwardBytes += pkt->getSize();
+		//pkt itself is sent, memory turns it into the response
+		return lat + memPort.sendAtomic(pkt);
+	}
+
+	if(accessFunctional(pkt))
+		hits++;
+	else
+	{
+		misses++;
+
+		//fetch the whole block from memory and fill it, the access then hits on the new block
+		assert(pkt->isRead() || pkt->isWrite());
+		PacketPtr fill_pkt = new Packet(pkt->req, MemCmd::ReadReq, blockSize);
+		fill_pkt->allocate();
+
+		DPRINTF(BCache, "Atomic miss for addr: %x\n", pkt->getAddr());
+		lat += memPort.sendAtomic(fill_pkt);
+		BCBlock *blk = insert(fill_pkt, true);
+		panic_if(blk == nullptr, "Atomic access with sector fills in flight\n");
+		delete fill_pkt;
+
+		bool hit = accessFunctional(pkt);
+		assert(hit);
+		missLatency.sample(lat);
+	}
+
+	if(pkt->needsResponse())
+		pkt->makeResponse();
+	return lat;
+}
+
+bool BlockingCache::isIdle() const
+{
+	if(accessesInFlight > 0 || activeMSHRs > 0 || !deferredTargets.empty() || !memPort.isIdle() ||
+		!inlineResponses.empty() || !forwardedWrites.empty())
+		return false;
+	for(auto &port: cpuPorts)
+	{
+		if(!port.isIdle())
+			return false;
+	}
+	return true;
+}
+
+void BlockingCache::tryDrainDone()
+{
+	if(drainState() == DrainState::Draining && isIdle())
+	{
+		DPRINTF(BCache, "Drained\n");
+		signalDrainDone();
+	}
+}
+
+DrainState BlockingCache::drain()
+{
+	//cached data stays, only the transfers in flight have to complete
+	if(isIdle())
+		return DrainState::Drained;
+	DPRINTF(BCache, "Draining\n");
+	return DrainState::Draining;
+}
+
+void BlockingCache::memWriteback()
+{
+	//called on a drained system, so the writes are done functionally
+	tags.forEachValid([this](BCBlock *blk)
+	{
+		if(!blk->dirty)
+			return;
+		RequestPtr req(new Request(blk->tag, blockSize, 0, 0));
+		Packet pkt(req, MemCmd::WriteReq);
+		pkt.dataStatic(blk->data);
+		memPort.sendFunctional(&pkt);
+		blk->dirty = false;
+		blk->dirtySectors = 0;
+	});
+}
+
+void BlockingCache::serialize(CheckpointOut &cp) const
+{
+	assert(isIdle());
+	tags.serialize(cp);
+}
+
+void BlockingCache::unserialize(CheckpointIn &cp)
+{
+	tags.unserialize(cp);
+}
+
 AddrRangeList BlockingCache::getAddrRanges() const
 {
 	return memPort.getAddrRanges();
@@ -172,7 +1144,7 @@ void MemSidePort::recvRangeChange()
 
 void BlockingCache::sendRangeChange()
 {
-	for(auto port: cpuPorts)
+	for(auto &port: cpuPorts)
 		port.sendRangeChange();
 }
 
@@ -197,38 +1169,178 @@ bool CPUSidePort::recvTimingReq(PacketPtr pkt)
 
 bool BlockingCache::handleRequest(PacketPtr pkt, int portID)
 {
-	if(blocked)//new requests blocked
+	if(blocked)//new requests blocked until an MSHR is freed
 		return false;
-	
-	DPRINTF(BCache, "Got request for addr: %x\n", pkt->getAddr());
-	blocked = true;
-	waitingPortID = portID;//request accepted, block future requests
-	
-	schedule(new AccessEvent(this, pkt), clockEdge(latency));//schedule cache access after latency delay
+
+	//a request crossing blocks accesses the bank of every block it touches, all of them have to be
+	//free. The access itself goes through the pipeline of the first one
+	Addr end = pkt->getAddr() + pkt->getSize();
+	unsigned bank_id = bankOf(pkt->getAddr());
+	Bank &bank = *banks[bank_id];
+	for(Addr addr = pkt->getBlockAddr(blockSize); addr < end; addr += blockSize)
+	{
+		unsigned busy_id = bankOf(addr);
+		Tick next_free = banks[busy_id]->nextFree;
+		if(next_free > curTick())//bank conflict, the bank already started an access this cycle
+		{
+			DPRINTF(BCache, "Bank %d busy, rejecting addr: %x\n", busy_id, pkt->getAddr());
+			bankConflicts[busy_id]++;
+			if(!bankRetryEvent.scheduled())
+				schedule(bankRetryEvent, next_free);
+			else if(bankRetryEvent.when() > next_free)
+				reschedule(bankRetryEvent, next_free);
+			return false;
+		}
+	}
+
+	DPRINTF(BCache, "Got request for addr: %x in bank %d\n", pkt->getAddr(), bank_id);
+	accessesInFlight++;
+	for(Addr addr = pkt->getBlockAddr(blockSize); addr < end; addr += blockSize)
+	{
+		bankAccesses[bankOf(addr)]++;
+		banks[bankOf(addr)]->nextFree = clockEdge(Cycles(1));
+	}
+
+	//zero latency, nothing to wait for. The access is performed right away, without an event
+	if(latency == 0)
+	{
+		inlineAccess = true;
+		accessTiming(pkt, portID);
+		inlineAccess = false;
+		return true;
+	}
+
+	//the access is performed after latency delay
+	Tick ready = clockEdge(latency);
+	bank.push({pkt, portID, ready});
+
+	EventFunctionWrapper &event = batchAccesses ? batchEvent : bank.event;
+	if(!event.scheduled())
+		schedule(event, ready);
 
 	return true;
 }
 
+void BlockingCache::runBank(Bank &bank)
+{
+	//the latency is the same for every access, so the pipeline completes in order
+	while(!bank.empty() && bank.front().readyTick <= curTick())
+	{
+		Access access = bank.front();
+		bank.pop();
+		accessTiming(access.pkt, access.portID);
+	}
+}
+
+void BlockingCache::processBank(unsigned bank_id)
+{
+	Bank &bank = *banks[bank_id];
+	runBank(bank);
+
+	if(!bank.empty() && !bank.event.scheduled())
+		schedule(bank.event, bank.front().readyTick);
+}
+
+void BlockingCache::processBatch()
+{
+	Tick next = MaxTick;
+	for(auto &bank: banks)
+	{
+		runBank(*bank);
+		if(!bank->empty())
+			next = std::min(next, bank->front().readyTick);
+	}
+
+	if(next != MaxTick && !batchEvent.scheduled())
+		schedule(batchEvent, next);
+}
+
+void BlockingCache::processBankRetry()
+{
+	for(auto &port: cpuPorts)
+		port.trySendRetry();
+}
+
 void MemSidePort::sendPacket(PacketPtr pkt)
 {
-	//the case when previous req sent by owner isn't handled yet, wait!
-	panic_if(blockedPacket != nullptr, "Don't send when receiver blocked!");
+	//queue behind earlier requests to keep the order, sent right away if the slave is free
+	reqQueue.push_back(pkt);
+	trySendQueued();
+}
 
-	//request conditionally accepted by MemSidePort
-	if(!sendTimingReq(pkt))
-		blockedPacket = pkt;
+void MemSidePort::sendWriteback(PacketPtr pkt)
+{
+	panic_if(writeBuffer.size() >= writeBufferSize, "Write buffer overflow\n");
+	writeBuffer.push_back(pkt);
+	trySendQueued();
+}
+
+void MemSidePort::trySendQueued()
+{
+	while(!waitingForRetry)
+	{
+		//demand fills have a CPU request waiting on them, writebacks only go when none is queued
+		std::deque<PacketPtr> &queue = reqQueue.empty() ? writeBuffer : reqQueue;
+		if(queue.empty())
+			return;
+
+		//request conditionally accepted by the slave port, stays queued until it is
+		if(!sendTimingReq(queue.front()))
+		{
+			waitingForRetry = true;
+			retryWaitStart = curTick();
+			return;
+		}
+		queue.pop_front();
+	}
+}
+
+bool MemSidePort::hasWriteback(Addr block_addr) const
+{
+	for(auto wb_pkt: writeBuffer)
+	{
+		if(wb_pkt->getBlockAddr(blockSize) == block_addr)
+			return true;
+	}
+	return false;
+}
+
+PacketPtr MemSidePort::extractWriteback(Addr block_addr)
+{
+	for(auto it = writeBuffer.begin(); it != writeBuffer.end(); it++)
+	{
+		if((*it)->getBlockAddr(blockSize) == block_addr)
+		{
+			PacketPtr pkt = *it;
+			writeBuffer.erase(it);
+			return pkt;
+		}
+	}
+	return nullptr;
+}
+
+bool MemSidePort::trySatisfyFunctional(PacketPtr pkt)
+{
+	for(auto wb_pkt: writeBuffer)
+	{
+		if(wb_pkt->hasData() && pkt->trySatisfyFunctional(wb_pkt))
+			return true;
+	}
+	return false;
 }
 
 void MemSidePort::recvReqRetry()
 {
 	//slave free now, can reattempt req, but req should exist in the first place.
-	assert(blockedPacket != nullptr);
+	assert(waitingForRetry);
+	waitingForRetry = false;
 
-	//port tries to send request to memory
-	PacketPtr ptr = blockedPacket;
-	blockedPacket = nullptr;
+	//drain the queues until the slave blocks again
+	trySendQueued();
 
-	sendPacket(ptr);
+	//write buffer entries may have been freed, the owner can take new misses again
+	owner->handleReqRetry(curTick() - retryWaitStart);
+	owner->tryDrainDone();
 }
 
 bool MemSidePort::recvTimingResp(PacketPtr pkt)
@@ -238,28 +1350,90 @@ bool MemSidePort::recvTimingResp(PacketPtr pkt)
 
 bool BlockingCache::handleResponse(PacketPtr pkt)
 {
-	assert(blocked);
 	DPRINTF(BCache, "Out resp for addr: %x\n", pkt->getAddr());
-	insert(pkt); // received response from memory, now inserting it into cache
 
-	if(pendingPkt != nullptr)
+	//a write sent on by the write policy, its answer goes back to the CPU as is
+	if(pkt->isWrite())
+	{
+		auto it = forwardedWrites.find(pkt);
+		assert(it != forwardedWrites.end());
+		int port_id = it->second;
+		forwardedWrites.erase(it);
+		sendResponse(pkt, port_id);
+		tryDrainDone();
+		return true;
+	}
+
+	MSHR *mshr = findMSHR(pkt->getBlockAddr(blockSize));
+	assert(mshr != nullptr);
+
+	if(sectored)
+		fillSectors(mshr, pkt);
+	else
 	{
-		missLatency.sample(curTick() - missTime);
-		accessFunctional(pendingPkt); //accessing the cache after data response has been inserted
-		pendingPkt->makeResponse(); // converting the request to a response type
-		delete pkt;
-		pkt = pendingPkt;
-		pendingPkt = nullptr;
+		BCBlock *blk = insert(pkt); // received response from memory, now inserting it into cache
+		assert(blk != nullptr);
+		blk->prefetched = mshr->isPrefetch;
+
+		//every request waiting on this block can now be serviced from the cache
+		for(auto &target: mshr->targets)
+		{
+			missLatency.sample(curTick() - target.recvTime);
+			bool hit = accessFunctional(target.pkt); //accessing the cache after data response has been inserted
+			assert(hit);
+			target.pkt->makeResponse(); // converting the request to a response type
+			sendResponse(target.pkt, target.portID); //returning resp to the host CPU
+		}
+		freeMSHR(mshr);
 	}
 
-	sendResponse(pkt); //returning resp to the host CPU
+	delete pkt;
+
+	replayDeferred();
+	updateBlocked();
+	if(prefetcher)
+		issuePrefetches();
+	tryDrainDone();
 	return true;
 }
 
+void BlockingCache::handleReqRetry(Tick stalled)
+{
+	memRetryStallCycles += ticksToCycles(stalled);
+	replayDeferred();
+	updateBlocked();
+	if(prefetcher)
+		issuePrefetches();
+}
+
+void BlockingCache::replayDeferred()
+{
+	//replay the misses which could not get an MSHR, they may have been filled in the meantime
+	std::deque<Target> deferred;
+	deferred.swap(deferredTargets);
+	for(auto &target: deferred)
+	{
+		if(bypassesCache(target.pkt))
+			handleWriteAround(target.pkt, target.portID);
+		else if(!waitsOnFill(target.pkt) && accessFunctional(target.pkt))
+		{
+			missLatency.sample(curTick() - target.recvTime);
+			target.pkt->makeResponse();
+			sendResponse(target.pkt, target.portID);
+		}
+		else
+			handleMiss(target.pkt, target.portID, target.recvTime);
+	}
+}
+
 void CPUSidePort::sendPacket(PacketPtr pkt)
 {
-	//the case hen the previous response from owner isn't handled yet, wait!
-	panic_if(blockedPacket != nullptr, "dont send when blocked\n");
+	//the case when the previous response from owner isn't handled yet, queue behind it
+	if(blockedPacket != nullptr)
+	{
+		respQueue.push_back(pkt);
+		return;
+	}
 
 	//port can send response from owner to cpu, conditionally. block if CPU busy
 	if(!sendTimingResp(pkt))
@@ -277,6 +1451,17 @@ void CPUSidePort::recvRespRetry()
 
 	//send packet to CPU
 	sendPacket(ptr);
+
+	//send the responses which completed in the meantime, until the CPU blocks again
+	while(blockedPacket == nullptr && !respQueue.empty())
+	{
+		ptr = respQueue.front();
+		respQueue.pop_front();
+		sendPacket(ptr);
+	}
+
+	trySendRetry();
+	owner->tryDrainDone();
 }
 
 void CPUSidePort::trySendRetry()
@@ -306,10 +1491,138 @@ void BlockingCache::regStats()
 						 .desc("Histogram of miss latencies")
 						 .init(10);
 
+	mshrHits.name(name()+".mshrHits")
+					.desc("Number of misses coalesced into an outstanding MSHR");
+
+	mshrFullBlocks.name(name()+".mshrFullBlocks")
+								.desc("Number of times the cache blocked with all MSHRs in use");
+
+	targetFullBlocks.name(name()+".targetFullBlocks")
+									.desc("Number of times the cache blocked on a full MSHR target list");
+
+	mshrOccupancy.name(name()+".mshrOccupancy")
+							 .desc("Histogram of outstanding MSHRs at each allocation")
+							 .init(numMSHRs);
+
+	outstandingMissTicks.name(name()+".outstandingMissTicks")
+											.desc("Sum over ticks of the number of outstanding MSHRs");
+
+	missBusyTicks.name(name()+".missBusyTicks")
+							 .desc("Ticks with at least one outstanding MSHR");
+
+	mlp.name(name()+".mlp")
+		 .desc("Miss-level parallelism, average outstanding MSHRs while any is outstanding");
+
+	mlp = outstandingMissTicks / missBusyTicks;
+
 	hitRatio.name(name()+".hitRatio")
 					.desc("Hit Ratio of cache");
 	
 	hitRatio = hits / (hits + misses);
+
+	dirtyEvictions.name(name()+".dirtyEvictions")
+								.desc("Number of evicted blocks written back to memory");
+
+	cleanEvictions.name(name()+".cleanEvictions")
+								.desc("Number of evicted clean blocks, not written back");
+
+	writebackBytes.name(name()+".writebackBytes")
+								.desc("Bytes written back to memory on evictions");
+
+	sectorFills.name(name()+".sectorFills")
+						 .desc("Number of sector reads sent to memory");
+
+	criticalFirstResponses.name(name()+".criticalFirstResponses")
+												.desc("Number of misses answered before the rest of their block arrived");
+
+	firstUseSavedTicks.name(name()+".firstUseSavedTicks")
+										.desc("Ticks gained by misses answered critical sector first over a whole block fill");
+
+	avgFirstUseSaving.name(name()+".avgFirstUseSaving")
+									 .desc("Average ticks gained per miss answered critical sector first");
+
+	avgFirstUseSaving = firstUseSavedTicks / criticalFirstResponses;
+
+	writeAllocNoFetch.name(name()+".writeAllocNoFetch")
+									 .desc("Number of whole sector write misses written without a read");
+
+	fetchBytesAvoided.name(name()+".fetchBytesAvoided")
+									 .desc("Bytes not read from memory thanks to whole sector writes");
+
+	sectorVictimStalls.name(name()+".sectorVictimStalls")
+										.desc("Number of misses deferred because every way of their set was being filled");
+
+	writesForwarded.name(name()+".writesForwarded")
+								 .desc("Number of writes sent to memory without allocating or dirtying a block");
+
+	writeForwardBytes.name(name()+".writeForwardBytes")
+									 .desc("Bytes of the writes sent to memory without allocating or dirtying a block");
+
+	streamsDetected.name(name()+".streamsDetected")
+								 .desc("Number of sequential write runs detected as streaming stores");
+
+	streamingWrites.name(name()+".streamingWrites")
+								 .desc("Number of write misses not allocated because of a detected stream");
+
+	splitRequests.name(name()+".splitRequests")
+							 .desc("Number of requests crossing blocks, split into one access per block");
+
+	splitPieceAccesses.name(name()+".splitPieceAccesses")
+										.desc("Number of per block accesses split requests were performed as");
+
+	writeBufferHits.name(name()+".writeBufferHits")
+								 .desc("Number of misses serviced from the write buffer");
+
+	writeBufferOccupancy.name(name()+".writeBufferOccupancy")
+											.desc("Histogram of write buffer entries in use at each eviction")
+											.init(writeBuffers);
+
+	writeBufferStallCycles.name(name()+".writeBufferStallCycles")
+												.desc("Cycles blocked for lack of write buffer entries");
+
+	memRetryStallCycles.name(name()+".memRetryStallCycles")
+										 .desc("Cycles mem_side waited for a retry from memory");
+
+	prefetchesIssued.name(name()+".prefetchesIssued")
+									.desc("Number of prefetches sent to memory");
+
+	prefetchesDropped.name(name()+".prefetchesDropped")
+									 .desc("Number of prefetch candidates dropped as redundant or for lack of space");
+
+	usefulPrefetches.name(name()+".usefulPrefetches")
+									.desc("Number of prefetched blocks demanded before eviction");
+
+	latePrefetches.name(name()+".latePrefetches")
+								.desc("Number of demand misses on a prefetch still in flight");
+
+	uselessPrefetches.name(name()+".uselessPrefetches")
+									 .desc("Number of prefetched blocks evicted without a demand access");
+
+	prefetchAccuracy.name(name()+".prefetchAccuracy")
+									.desc("Fraction of issued prefetches which were useful or late");
+
+	prefetchAccuracy = (usefulPrefetches + latePrefetches) / prefetchesIssued;
+
+	prefetchCoverage.name(name()+".prefetchCoverage")
+									.desc("Fraction of would-be misses removed by prefetching");
+
+	prefetchCoverage = usefulPrefetches / (usefulPrefetches + misses);
+
+	bankAccesses.name(name()+".bankAccesses")
+							.desc("Number of accesses started by each bank")
+							.init(numBanks);
+
+	bankConflicts.name(name()+".bankConflicts")
+							 .desc("Number of requests rejected because their bank was busy")
+							 .init(numBanks);
+
+	bankUtilization.name(name()+".bankUtilization")
+								 .desc("Fraction of cycles in which each bank started an access");
+
+	bankUtilization = bankAccesses * Stats::constant(clockPeriod()) / simTicks;
+
+	replacements.name(name()+".replacements")
+							.desc("Number of valid blocks evicted by the " + replPolicyName + " policy");
 }
 
 BlockingCache* BlockingCacheParams::create()
@@ -1,13 +1,20 @@
 #ifndef __LEARNING_GEM5_BLOCKING_CACHE_BLOCKING_CACHE_HH__
 #define __LEARNING_GEM5_BLOCKING_CACHE_BLOCKING_CACHE_HH__
 
-#include <vector>
+#include <algorithm>
+#include <deque>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
+#include "enums/BCWritePolicy.hh"
+#include "learning_gem5/blocking_cache/prefetcher.hh"
+#include "learning_gem5/blocking_cache/tag_array.hh"
 #include "mem/port.hh"
 #include "mem/mem_object.hh"
 #include "sim/sim_object.hh"
 #include "params/BlockingCache.hh"
+#include "sim/eventq.hh"
 
 class CPUSidePort : public SlavePort
 {
@@ -19,6 +26,10 @@ class CPUSidePort : public SlavePort
 		//The packet which is being processed - sent to memPort for response or currently being processed
 		PacketPtr blockedPacket;
 
+		//Responses produced while blockedPacket is waiting for the master. With several MSHRs more than
+		//one response can complete for the same port, these are sent in order once the master retries
+		std::deque<PacketPtr> respQueue;
+
 		//If the master sends a request when the cache is busy, it is recorded here. Once a packet is
 		//processed, sendReqRetry() is called to inform the master to try sending req again
 		bool needRetry;
@@ -27,6 +38,9 @@ class CPUSidePort : public SlavePort
 		int id;
 
 	public:
+		//true if the port has no response waiting for the master
+		bool isIdle() const { return blockedPacket == nullptr && respQueue.empty(); }
+
 		CPUSidePort(const std::string& name, int id, BlockingCache* owner) :
 			SlavePort(name, (SimObject*) owner), //Parent Class' constructor
 			owner(owner),
@@ -47,8 +61,8 @@ class CPUSidePort : public SlavePort
 		void trySendRetry();
 
 	protected:
-		//not implemented
-		Tick recvAtomic(PacketPtr pkt) override { panic("recvAtomic	unimplemented");}
+		//Atomic access, forwarded to owner which returns the modeled latency
+		Tick recvAtomic(PacketPtr pkt) override;
 
 		//In case of a functional query with a packet, forward it to owner
 		void recvFunctional(PacketPtr pkt) override;
@@ -65,23 +79,63 @@ class MemSidePort : public MasterPort
 	private:
 		//The Cache object this port belongs to
 		BlockingCache *owner;
-		//store packet if the slave port is busy to accept packet
-		PacketPtr blockedPacket;
+		//set once the slave port rejects a request, nothing is sent until it calls recvReqRetry
+		bool waitingForRetry;
+		//tick at which the slave port last rejected a request, used for stall stats
+		Tick retryWaitStart;
+
+		//demand requests (block or sector fills, and writes sent on by the write policy) waiting for
+		//the slave port, and evictions which have to reach memory before a request for their block.
+		//These are always sent before the write buffer
+		std::deque<PacketPtr> reqQueue;
+
+		//evictions (WritebackDirty/CleanEvict) waiting for the slave port. The owner reserves a slot for
+		//every outstanding MSHR, so this never holds more than writeBufferSize packets
+		std::deque<PacketPtr> writeBuffer;
+		const unsigned writeBufferSize;
+		//evictions are matched to misses and writes by block
+		const unsigned blockSize;
+
+		//sends queued packets, fills first, until both queues are empty or the slave port blocks
+		void trySendQueued();
 
 	public:
-		MemSidePort(const std::string &name, BlockingCache* owner) :
+		MemSidePort(const std::string &name, BlockingCache* owner, unsigned write_buffers,
+			unsigned block_size) :
 			MasterPort(name, (SimObject*) owner), //Constructor of Parent class
 			owner(owner),
-			blockedPacket(nullptr)
+			waitingForRetry(false),
+			retryWaitStart(0),
+			writeBufferSize(write_buffers),
+			blockSize(block_size)
 			{}
-		//Attempt to send packet to slave port, might get called multiple times for the same packet
+		//Queue a demand request for the slave port, sent right away unless the port is waiting for a retry
 		void sendPacket(PacketPtr pkt);
+		//Queue an eviction in the write buffer, sent once no demand request is waiting
+		void sendWriteback(PacketPtr pkt);
+
+		//number of free write buffer entries
+		unsigned writeBufferFree() const { return writeBufferSize - writeBuffer.size(); }
+		unsigned writeBufferOccupancy() const { return writeBuffer.size(); }
+
+		//true if an eviction of block_addr is waiting in the write buffer
+		bool hasWriteback(Addr block_addr) const;
+
+		//removes the queued eviction of block_addr from the write buffer and returns it, nullptr if
+		//there is none. Used when a miss finds its block still waiting to be written back
+		PacketPtr extractWriteback(Addr block_addr);
+
+		//functional accesses have to observe data which has not reached memory yet
+		bool trySatisfyFunctional(PacketPtr pkt);
+
+		//true if no request or writeback is waiting for the slave port
+		bool isIdle() const { return reqQueue.empty() && writeBuffer.empty(); }
 
 	protected:
 		// receive response packet from the slave port
 		bool recvTimingResp(PacketPtr pkt) override;
 		// this function is called by slave port for the master port to reattempt sending request,
-		// which failed earlier. The request is stored in blockedPacket variable.
+		// which failed earlier. The request is still at the front of its queue.
 		void recvReqRetry() override;
 		// Receive changes in address ranges from slave port, forwarded to owner
 		void recvRangeChange() override;
@@ -90,100 +144,432 @@ class MemSidePort : public MasterPort
 class BlockingCache : public MemObject
 {
 	private:
+		//A request waiting on an MSHR, along with the port it has to be returned to
+		struct Target
+		{
+			PacketPtr pkt;
+			int portID;
+			//tick at which the miss was detected, used for missLatency
+			Tick recvTime;
+		};
+
+		//A request crossing blocks, performed as one piece per block. Answered once every piece is
+		struct SplitAccess
+		{
+			PacketPtr pkt;
+			int portID;
+			unsigned piecesLeft;
+		};
+
+		//A request accepted by a bank, performed by accessTiming once readyTick is reached
+		struct Access
+		{
+			PacketPtr pkt;
+			int portID;
+			Tick readyTick;
+		};
+
+		//One address interleaved bank. A bank starts at most one access per cycle, the accesses it
+		//started go through its own pipeline and complete latency cycles later. Requests to different
+		//banks are accepted in the same cycle
+		struct Bank
+		{
+			//first tick at which the bank can start another access
+			Tick nextFree;
+			//accesses in flight, oldest (and so first to complete) at the front. A fixed size ring: with
+			//one access started per cycle, latency+1 slots are always enough and accesses never allocate
+			std::vector<Access> pipeline;
+			unsigned head;
+			unsigned count;
+			//performs the accesses at the front of pipeline once they are ready, unused when accesses
+			//are batched
+			EventFunctionWrapper event;
+
+			Bank(unsigned slots, std::function<void()> callback, const std::string &name) :
+				nextFree(0),
+				pipeline(slots),
+				head(0),
+				count(0),
+				event(callback, name)
+				{}
+
+			bool empty() const { return count == 0; }
+			const Access &front() const { return pipeline[head]; }
+			void push(const Access &access)
+			{
+				panic_if(count == pipeline.size(), "Bank pipeline overflow\n");
+				pipeline[(head + count) % pipeline.size()] = access;
+				count++;
+			}
+			void pop()
+			{
+				head = (head + 1) % pipeline.size();
+				count--;
+			}
+		};
+
+		//Miss Status Holding Register, tracks one outstanding block fill and every request to that
+		//block which arrived while the fill was in flight
+		struct MSHR
+		{
+			bool valid;
+			Addr blockAddr;
+			//allocated by the prefetcher and not demanded yet, targets is empty in that case
+			bool isPrefetch;
+			std::vector<Target> targets;
+			//sector reads sent for this block and not answered yet, the block is complete at 0
+			unsigned pendingFills;
+			//targets answered before the whole block arrived, and the sum of the ticks they were
+			//answered at, to compute how much earlier than a whole block fill they were served
+			unsigned earlyResponses;
+			Tick earlyResponseTicks;
+		};
+
 		//Cache access latency (tag+data)
 		const Cycles latency;
 		//Cache block size
 		const unsigned blockSize;
-		//number of sets
-		const unsigned capacity;
+		//bytes covered by one valid/dirty bit, and the number of sectors per block. With a single
+		//sector the cache fills whole blocks and none of the sector handling is used
+		const unsigned sectorSize;
+		const unsigned numSectors;
+		const bool sectored;
+		//mask with a bit set for every sector of a block
+		const uint64_t allSectors;
 		//slave ports to connect to CPU, to receive requests for instruction and data memory
 		std::vector<CPUSidePort> cpuPorts;
 		//master port to connect to main memory, to send requests & receive mem response.
 		MemSidePort memPort;
 		
-		//once blocked variable is set to true, it officially marks the end of CPUSidePort handling
-		//the packet. The slave port(s) will now wait for response back from the cache object
-		//unset only when the response packet has been accepted by the CPUSidePort
+		//number of MSHRs, i.e. distinct blocks which can be fetched from memory at the same time
+		const unsigned numMSHRs;
+		//number of requests which can wait on a single MSHR
+		const unsigned tgtsPerMSHR;
+		//send CleanEvict to the memory side for clean victims instead of dropping them silently
+		const bool sendCleanEvict;
+		//size of the write buffer on memPort
+		const unsigned writeBuffers;
+
+		//what write misses and write hits do, see BlockingCache.py
+		const BCWritePolicy writePolicy;
+		//whole blocks a run of sequential writes has to cover before write misses stop allocating, 0
+		//when the detection is off
+		const unsigned streamThreshold;
+		//first address of the current run of sequential writes, the address it continues at, and the
+		//number of whole blocks it wrote
+		Addr streamStart;
+		Addr streamNextAddr;
+		unsigned streamFullBlocks;
+
+		//number of banks, consecutive blocks go to consecutive banks
+		const unsigned numBanks;
+		std::vector<std::unique_ptr<Bank>> banks;
+		//sends retries to the ports turned down by a busy bank once it can take a request again
+		EventFunctionWrapper bankRetryEvent;
+
+		//when set, a single event performs the ready accesses of every bank, so all the requests
+		//accepted in a cycle cost one event instead of one per bank
+		const bool batchAccesses;
+		EventFunctionWrapper batchEvent;
+
+		//With a latency of 0 accesses are performed as soon as they are accepted, without going
+		//through a bank pipeline. Responses can not be sent back from inside recvTimingReq, so the
+		//ones produced meanwhile wait here for inlineRespEvent, in the same tick
+		bool inlineAccess;
+		std::vector<std::pair<PacketPtr, int>> inlineResponses;
+		EventFunctionWrapper inlineRespEvent;
+
+		//once blocked is set, the CPUSidePort(s) stop accepting requests. It is set when every MSHR is
+		//in use, when the target list of an MSHR is full or when a miss had to be deferred, and is
+		//cleared (followed by a retry to the ports) once an MSHR is freed
 		bool blocked;
 
-		//Used to store the current request packet if the request results in a cache miss. The variable
-		//is cleared when response for the memory request arrives from memory, is inserted into the cache
-		//While unset happens after another functional access from the cache, it does not incur any delay
-		//since the response as well can be directly forwarded to the CPUSidePort
-		PacketPtr pendingPkt;
-
-		//ID of the CPUSidePort from which the pending request was rceived, Used to forward response to
-		//appropriate port
-		int waitingPortID;
-
-		//Structure to store cached data
-		std::unordered_map<Addr, uint8_t*> cacheStore;
-
-		Tick missTime;
+		//MSHR file, allocated once at construction. Entries are recycled through the valid flag
+		std::vector<MSHR> mshrs;
+		//number of valid entries in mshrs
+		unsigned activeMSHRs;
+
+		//Misses which were already in the access pipeline when the MSHRs ran out. They are replayed in
+		//order when an MSHR is freed
+		std::deque<Target> deferredTargets;
+
+		//accepted requests which have not been through accessTiming yet, needed to know when drained
+		unsigned accessesInFlight;
+
+		//pieces of split requests which have not been answered yet, with the request they belong to
+		std::unordered_map<PacketPtr, SplitAccess*> pendingPieces;
+		//writes sent on to memory by the write policy, with the port their response goes back to
+		std::unordered_map<PacketPtr, int> forwardedWrites;
+
+		//Structure to store cached data, set associative tags over one contiguous data array
+		BCTagArray tags;
+		//name of the replacement policy, used to label stats
+		const std::string replPolicyName;
+
+		//hardware prefetcher, nullptr when disabled
+		std::unique_ptr<BCPrefetcher> prefetcher;
+		//block addresses proposed by the prefetcher which have not been issued yet, oldest first
+		std::deque<Addr> prefetchQueue;
+		const unsigned prefetchQueueSize;
+		//scratch vector the prefetcher appends candidates to, kept to avoid an allocation per access
+		std::vector<Addr> prefetchCandidates;
+
+		//last tick at which the number of outstanding MSHRs changed, used for MLP accounting
+		Tick lastMSHRUpdate;
+		//tick at which the cache blocked for lack of write buffer entries, MaxTick when not blocked so
+		Tick wbStallStart;
 
 		Stats::Scalar hits;
 		Stats::Scalar misses;
 		Stats::Histogram missLatency;
 		Stats::Formula hitRatio;
 
+		//accesses started by each bank, requests turned down because their bank was busy, and the
+		//fraction of cycles each bank started an access
+		Stats::Vector bankAccesses;
+		Stats::Vector bankConflicts;
+		Stats::Formula bankUtilization;
+
+		//evictions of valid blocks, labelled with the replacement policy
+		Stats::Scalar replacements;
+
+		//evictions split by the state of the victim, and the memory traffic they caused
+		Stats::Scalar dirtyEvictions;
+		Stats::Scalar cleanEvictions;
+		Stats::Scalar writebackBytes;
+
+		//sector reads sent to memory
+		Stats::Scalar sectorFills;
+		//misses answered before the rest of their block arrived, and the ticks they gained over
+		//waiting for the whole block
+		Stats::Scalar criticalFirstResponses;
+		Stats::Scalar firstUseSavedTicks;
+		Stats::Formula avgFirstUseSaving;
+		//whole sector write misses allocated without reading the sectors, and the bytes not read
+		Stats::Scalar writeAllocNoFetch;
+		Stats::Scalar fetchBytesAvoided;
+		//misses deferred because every way of their set was being filled
+		Stats::Scalar sectorVictimStalls;
+
+		//writes sent on to memory instead of allocating or dirtying a block, and their bytes
+		Stats::Scalar writesForwarded;
+		Stats::Scalar writeForwardBytes;
+		//runs of sequential writes which reached streamThreshold whole blocks, and the write misses
+		//they kept from allocating
+		Stats::Scalar streamsDetected;
+		Stats::Scalar streamingWrites;
+
+		//requests crossing blocks, and the per block pieces they were split into
+		Stats::Scalar splitRequests;
+		Stats::Scalar splitPieceAccesses;
+
+		//misses whose block was found waiting in the write buffer and was put back into the cache
+		Stats::Scalar writeBufferHits;
+		//number of queued evictions, sampled every time one is added to the write buffer
+		Stats::Histogram writeBufferOccupancy;
+		//cycles the cache was blocked because the write buffer had no entry left for a new MSHR
+		Stats::Scalar writeBufferStallCycles;
+		//cycles memPort waited for a retry from the memory side
+		Stats::Scalar memRetryStallCycles;
+
+		//prefetches sent to memory
+		Stats::Scalar prefetchesIssued;
+		//candidates dropped because the block was cached or in flight already, or the queue was full
+		Stats::Scalar prefetchesDropped;
+		//prefetched blocks demanded before being evicted
+		Stats::Scalar usefulPrefetches;
+		//demand misses which found a prefetch for their block still in flight
+		Stats::Scalar latePrefetches;
+		//prefetched blocks evicted without being demanded
+		Stats::Scalar uselessPrefetches;
+		//useful prefetches out of those issued, and misses removed out of all would-be misses
+		Stats::Formula prefetchAccuracy;
+		Stats::Formula prefetchCoverage;
+
+		//misses which found an MSHR for their block and were added to its target list
+		Stats::Scalar mshrHits;
+		//number of times the cache blocked because every MSHR was in use
+		Stats::Scalar mshrFullBlocks;
+		//number of times the cache blocked because an MSHR ran out of targets
+		Stats::Scalar targetFullBlocks;
+		//number of outstanding MSHRs, sampled every time a new one is allocated
+		Stats::Histogram mshrOccupancy;
+		//sum over time of the number of outstanding MSHRs, and time with at least one outstanding
+		Stats::Scalar outstandingMissTicks;
+		Stats::Scalar missBusyTicks;
+		//miss-level parallelism, average number of outstanding misses while there is at least one
+		Stats::Formula mlp;
+
+		//returns the valid MSHR tracking block_addr, nullptr if there is none
+		MSHR *findMSHR(Addr block_addr);
+		//allocates a free MSHR for block_addr and returns it, nullptr if all are in use
+		MSHR *allocateMSHR(Addr block_addr);
+		//releases mshr once its fill has been handled
+		void freeMSHR(MSHR *mshr);
+		//accumulates MLP stats up to curTick(), called before activeMSHRs changes
+		void updateMSHRTicks();
+		//recomputes the blocked flag, sends retries to the CPUSidePort(s) when the cache unblocks
+		void updateBlocked();
+		//bank an address belongs to
+		unsigned bankOf(Addr addr) const
+		{
+			return (addr / blockSize) % numBanks;
+		}
+		//performs the accesses of a bank whose latency has elapsed
+		void runBank(Bank &bank);
+		//bank event handler, runs the bank and schedules its next ready access
+		void processBank(unsigned bank_id);
+		//batchEvent handler, runs every bank and schedules the earliest next ready access
+		void processBatch();
+		//inlineRespEvent handler
+		void sendInlineResponses();
+		//bankRetryEvent handler
+		void processBankRetry();
+		//true when the write buffer can not take the victim of one more MSHR
+		bool writeBufferBlocked() const
+		{
+			return memPort.writeBufferFree() <= activeMSHRs;
+		}
+		//replays the misses which were deferred for lack of an MSHR or write buffer entry
+		void replayDeferred();
+		//trains the prefetcher on a demand access and queues the blocks it proposes. Takes the request
+		//rather than the packet, which may have been answered and deleted by then
+		void notifyPrefetcher(Addr block_addr, const RequestPtr &req, bool miss);
+		//sends queued prefetches while MSHRs are available, one MSHR is always left for demand misses
+		void issuePrefetches();
+		//a miss whose block is still in the write buffer is put back into the cache from there and
+		//answered, returns false if the block is not in the write buffer
+		bool serviceFromWriteBuffer(PacketPtr pkt, int port_id, Tick recv_time);
+		//allocates or coalesces an MSHR for a missing request, defers it if no resource is free
+		void handleMiss(PacketPtr pkt, int port_id, Tick recv_time);
+
+		//true if pkt touches more than one block
+		bool crossesBlock(PacketPtr pkt) const
+		{
+			return pkt->getBlockAddr(blockSize) !=
+				((pkt->getAddr() + pkt->getSize() - 1) & ~Addr(blockSize - 1));
+		}
+		//request for the size bytes at addr, a piece of the request of pkt
+		RequestPtr pieceRequest(PacketPtr pkt, Addr addr, unsigned size) const;
+		//calls fn(request, offset in pkt) for the part of pkt in every block it touches, in order
+		template <typename F>
+		void forEachPiece(PacketPtr pkt, F fn)
+		{
+			Addr start = pkt->getAddr();
+			Addr end = start + pkt->getSize();
+			for(Addr addr = start; addr < end; )
+			{
+				Addr next = std::min(end, (addr & ~Addr(blockSize - 1)) + blockSize);
+				fn(pieceRequest(pkt, addr, next - addr), addr - start);
+				addr = next;
+			}
+		}
+		//performs a request within one block: answers a hit, hands a miss to handleMiss
+		void accessBlock(PacketPtr pkt, int port_id);
+		//splits a request crossing blocks into one packet per block, sharing its data, and performs
+		//them all at once so that their misses are outstanding together
+		void accessSplit(PacketPtr pkt, int port_id);
+		//a piece of a split request was answered, the request is once it was the last one. Returns
+		//false if pkt is not a piece
+		bool completePiece(PacketPtr pkt);
+
+		//follows the runs of sequential writes, for streaming store detection
+		void trainStreamDetector(PacketPtr pkt);
+		//true while the current run of sequential writes covered streamThreshold whole blocks
+		bool streaming() const
+		{
+			return streamThreshold > 0 && streamFullBlocks >= streamThreshold;
+		}
+		//true if the write policy sends pkt to memory instead of performing it on a cached block. A
+		//write to a block being filled always waits for the fill and is performed on the block
+		bool bypassesCache(PacketPtr pkt);
+		//updates the block pkt hits without dirtying it, if cached, and sends pkt on to memory.
+		//Returns true on a hit
+		bool handleWriteAround(PacketPtr pkt, int port_id);
+
+		//sectors of a block touched by size bytes at offset
+		uint64_t sectorMask(Addr offset, unsigned size) const;
+		//true if every sector pkt touches is valid in blk
+		bool sectorsValid(const BCBlock *blk, PacketPtr pkt) const;
+		//true if pkt touches a sector an older request waiting on the fill of its block needs. Such an
+		//access has to wait behind it even if its sectors are valid already
+		bool waitsOnFill(PacketPtr pkt);
+		//handleMiss of a sectored cache. The block is allocated right away and stays pinned while its
+		//sectors are fetched, the sectors of the request first
+		void handleSectoredMiss(PacketPtr pkt, int port_id, Tick recv_time);
+		//evicts a victim for block_addr and inserts it with no valid sector, nullptr if every way of
+		//the set is being filled
+		BCBlock *allocateFillingBlock(Addr block_addr);
+		//a write of whole sectors needs nothing from memory, writes it into blk and returns true. mshr
+		//is the fill in flight for blk, if any
+		bool writeFullSectors(BCBlock *blk, MSHR *mshr, PacketPtr pkt);
+		//sends one read for the contiguous sectors, to be filled into the block of mshr
+		void sendSectorFill(MSHR *mshr, uint64_t sectors);
+		//sends the critical sectors, then one read per run of the other sectors missing from blk
+		void sendSectorFills(MSHR *mshr, BCBlock *blk, uint64_t critical);
+		//copies the sectors of pkt into the block of mshr and answers the targets which can now be
+		//served, frees mshr once every sector arrived
+		void fillSectors(MSHR *mshr, PacketPtr pkt);
+
 	public:
 		BlockingCache(BlockingCacheParams *params);
 
 		Port &getPort(const std::string &if_name, PortID idx = InvalidPortID) override;
 
-		//Called by the CPUSidePort(s) to send request. This in turn schedules an event after latency
-		//cycles to perform cache access
+		//Called by the CPUSidePort(s) to send request. The request enters the pipeline of its bank and
+		//the cache access is performed latency cycles later. Rejected if the bank already started an
+		//access this cycle
 		bool handleRequest(PacketPtr pkt, int port_id);
 
 		//called by the MemSidePort to send response back. This inserts the block into the cache, prepares
 		//the response packet from original request packet, and sends response to CPUSidePort
 		bool handleResponse(PacketPtr pkt);
 
+		//called by the MemSidePort once it drained its queues after a retry, stalled is the time it
+		//waited for the retry
+		void handleReqRetry(Tick stalled);
+
 		//Functional Data access from the CPU is serviced using this function
 		void handleFunctional(PacketPtr pkt);
 
+		//Atomic access from the CPU, used when fast-forwarding. Goes through the same tags and data as
+		//timing accesses so the cache stays warm across a CPU switch. Returns the modeled latency
+		Tick handleAtomic(PacketPtr pkt);
+
+		//true once nothing is in flight: no access, MSHR, queued packet or pending response
+		bool isIdle() const;
+		//signals drain completion if a drain was requested and the cache just became idle
+		void tryDrainDone();
+
+		DrainState drain() override;
+		//writes dirty blocks back to memory before a checkpoint, leaving them clean in the cache
+		void memWriteback() override;
+		//cache contents are saved so that a restored run starts with warm caches
+		void serialize(CheckpointOut &cp) const override;
+		void unserialize(CheckpointIn &cp) override;
+
 		//address range of memory port is queried using this function
 		AddrRangeList getAddrRanges() const;
 
 		//this function is used by MemSidePort to push changes in memory address ranges
 		void sendRangeChange();
 
-		//called by handleResponse(), sends response to CPUSidePort
-		void sendResponse(PacketPtr pkt);
+		//sends a response to the CPUSidePort the request was received on
+		void sendResponse(PacketPtr pkt, int port_id);
 		//after incurring latency delay, this function is called by event handler. Resolves a request
-		//into HIT or MISS. Resonds back in case of hit or forwards request to MemSidePort, pendingPkt
-		//variable is set in which case
-		void accessTiming(PacketPtr pkt);
+		//into HIT or MISS. Resonds back in case of hit or allocates/coalesces an MSHR for it on a miss.
+		//A request crossing blocks is split, one access per block
+		void accessTiming(PacketPtr pkt, int port_id);
 		//Functional access of the data array. Performs Read/Write in case of HIT and returns true. If
 		//MISS, returns false
 		bool accessFunctional(PacketPtr pkt);
-		//helper function to insert data present in pkt into the cache
-		void insert(PacketPtr pkt);
+		//helper function to insert data present in pkt into the cache, returns the filled block
+		BCBlock *insert(PacketPtr pkt, bool atomic = false);
+		//removes a valid block from the cache, writing it back to memory only if it is dirty. In atomic
+		//mode the writeback is sent with sendAtomic instead of going through the write buffer
+		void evict(BCBlock *blk, bool atomic = false);
 
 		void regStats() override;
 };
 
-class AccessEvent : public Event
-{
-	private:
-		//the cache in which this event occurs
-		BlockingCache *cache;
-		//the packet which is processed in this event
-		PacketPtr pkt;
-	
-	public:
-		AccessEvent(BlockingCache *cache, PacketPtr pkt) :
-			Event(Default_Pri, AutoDelete), //AutoDelete is used to automatically free the event once processed
-			cache(cache), 
-			pkt(pkt)
-			{}
-
-		//Once this event is scheduled, this function gets called after latency delay. Performs the actual
-		//cache access
-		void process() override
-		{
-			cache->accessTiming(pkt);
-		}
-};
-
 #endif
@@ -0,0 +1,148 @@
+#include "learning_gem5/blocking_cache/prefetcher.hh"
+
+#include "base/logging.hh"
+
+void BCPrefetcher::addCandidate(Addr trigger, Addr addr, std::vector<Addr> &addresses) const
+{
+	if((addr & ~(pageBytes - 1)) == (trigger & ~(pageBytes - 1)))
+		addresses.push_back(addr);
+}
+
+BCPrefetcher* BCPrefetcher::create(BCPrefetcherType type, unsigned block_size, unsigned degree,
+	unsigned table_entries)
+{
+	fatal_if(type != BCPrefetcherType::None && degree == 0, "Prefetch degree must be at least 1\n");
+
+	switch(type)
+	{
+		case BCPrefetcherType::None:
+			return nullptr;
+		case BCPrefetcherType::NextLine:
+			return new BCNextLinePrefetcher(block_size, degree);
+		case BCPrefetcherType::Stride:
+			return new BCStridePrefetcher(block_size, degree, table_entries);
+		case BCPrefetcherType::Stream:
+			return new BCStreamPrefetcher(block_size, degree, table_entries);
+		default:
+			panic("Unknown prefetcher type\n");
+	}
+}
+
+void BCNextLinePrefetcher::notify(Addr block_addr, Addr pc, bool has_pc, bool miss,
+	std::vector<Addr> &addresses)
+{
+	if(!miss)
+		return;
+	for(unsigned i=1; i<=degree; i++)
+		addCandidate(block_addr, block_addr + i * blockSize, addresses);
+}
+
+BCStridePrefetcher::BCStridePrefetcher(unsigned block_size, unsigned degree, unsigned table_entries) :
+	BCPrefetcher(block_size, degree),
+	table(table_entries)
+	{
+		fatal_if(table_entries == 0, "Stride prefetcher needs at least one table entry\n");
+		for(auto &entry: table)
+			entry.valid = false;
+	}
+
+void BCStridePrefetcher::notify(Addr block_addr, Addr pc, bool has_pc, bool miss,
+	std::vector<Addr> &addresses)
+{
+	//strides are tracked per instruction, accesses without a pc can not be trained on
+	if(!has_pc)
+		return;
+
+	Entry &entry = table[pc % table.size()];
+	if(!entry.valid || entry.pc != pc)
+	{
+		entry.valid = true;
+		entry.pc = pc;
+		entry.lastAddr = block_addr;
+		entry.stride = 0;
+		entry.confidence = 0;
+		return;
+	}
+
+	int64_t stride = (int64_t)block_addr - (int64_t)entry.lastAddr;
+	//same block again, nothing learnt
+	if(stride == 0)
+		return;
+
+	if(stride == entry.stride)
+	{
+		if(entry.confidence < maxConfidence)
+			entry.confidence++;
+	}
+	else if(entry.confidence > 0)
+		entry.confidence--;
+	else
+		entry.stride = stride;
+	entry.lastAddr = block_addr;
+
+	if(entry.confidence < confidenceThreshold)
+		return;
+	for(unsigned i=1; i<=degree; i++)
+		addCandidate(block_addr, block_addr + i * entry.stride, addresses);
+}
+
+BCStreamPrefetcher::BCStreamPrefetcher(unsigned block_size, unsigned degree, unsigned num_streams) :
+	BCPrefetcher(block_size, degree),
+	streams(num_streams),
+	useCount(0)
+	{
+		fatal_if(num_streams == 0, "Stream prefetcher needs at least one stream\n");
+		for(auto &stream: streams)
+			stream.valid = false;
+	}
+
+void BCStreamPrefetcher::notify(Addr block_addr, Addr pc, bool has_pc, bool miss,
+	std::vector<Addr> &addresses)
+{
+	if(!miss)
+		return;
+
+	Stream *lru = &streams[0];
+	for(auto &stream: streams)
+	{
+		if(!stream.valid)
+		{
+			if(lru->valid)
+				lru = &stream;
+			continue;
+		}
+		if(lru->valid && stream.lastUse < lru->lastUse)
+			lru = &stream;
+
+		int64_t delta = ((int64_t)block_addr - (int64_t)stream.lastBlock) / (int64_t)blockSize;
+		bool continues;
+		if(stream.dir == 0)
+		{
+			//training, the neighbouring block in either direction confirms the stream
+			continues = (delta == 1 || delta == -1);
+			if(continues)
+				stream.dir = delta;
+		}
+		else
+		{
+			//confirmed, anything up to degree blocks ahead belongs to the stream. The blocks in between
+			//have been prefetched already
+			continues = delta * stream.dir > 0 && delta * stream.dir <= (int64_t)degree;
+		}
+
+		if(continues)
+		{
+			stream.lastBlock = block_addr;
+			stream.lastUse = ++useCount;
+			for(unsigned i=1; i<=degree; i++)
+				addCandidate(block_addr, block_addr + stream.dir * (int64_t)(i * blockSize), addresses);
+			return;
+		}
+	}
+
+	//no stream continues here, start training a new one
+	lru->valid = true;
+	lru->lastBlock = block_addr;
+	lru->dir = 0;
+	lru->lastUse = ++useCount;
+}
@@ -0,0 +1,110 @@
+#ifndef __LEARNING_GEM5_BLOCKING_CACHE_PREFETCHER_HH__
+#define __LEARNING_GEM5_BLOCKING_CACHE_PREFETCHER_HH__
+
+#include <cstdint>
+#include <vector>
+
+#include "base/types.hh"
+#include "enums/BCPrefetcherType.hh"
+
+//Hardware prefetcher interface used by BlockingCache. The cache calls notify() on every demand access
+//and queues the block addresses it returns, the prefetcher itself never touches the cache or memory
+class BCPrefetcher
+{
+	protected:
+		const unsigned blockSize;
+		//number of blocks requested per trigger
+		const unsigned degree;
+
+		//prefetches never leave the page of the access which triggered them, the next page may not be
+		//mapped (or may not even be memory)
+		static const Addr pageBytes = 4096;
+
+		//adds the block at addr to addresses if it is in the same page as trigger
+		void addCandidate(Addr trigger, Addr addr, std::vector<Addr> &addresses) const;
+
+	public:
+		BCPrefetcher(unsigned block_size, unsigned degree) :
+			blockSize(block_size),
+			degree(degree)
+			{}
+		virtual ~BCPrefetcher() {}
+
+		//called for every demand access. block_addr is the accessed block, pc is only meaningful when
+		//has_pc is set. miss is true for misses and for first hits on prefetched blocks, which are the
+		//misses the prefetcher removed. Block addresses to prefetch are appended to addresses
+		virtual void notify(Addr block_addr, Addr pc, bool has_pc, bool miss,
+			std::vector<Addr> &addresses) = 0;
+
+		//builds the prefetcher selected in BlockingCache.py, nullptr for None
+		static BCPrefetcher *create(BCPrefetcherType type, unsigned block_size, unsigned degree,
+			unsigned table_entries);
+};
+
+//Fetches the degree blocks following every miss
+class BCNextLinePrefetcher : public BCPrefetcher
+{
+	public:
+		BCNextLinePrefetcher(unsigned block_size, unsigned degree) :
+			BCPrefetcher(block_size, degree)
+			{}
+
+		void notify(Addr block_addr, Addr pc, bool has_pc, bool miss,
+			std::vector<Addr> &addresses) override;
+};
+
+//PC indexed stride detection. Once an instruction has accessed memory with the same stride twice in a
+//row, the degree next strides are fetched on each of its accesses
+class BCStridePrefetcher : public BCPrefetcher
+{
+	private:
+		struct Entry
+		{
+			bool valid;
+			Addr pc;
+			Addr lastAddr;
+			int64_t stride;
+			//saturating confidence in stride, prefetches are issued from confidenceThreshold up
+			unsigned confidence;
+		};
+
+		static const unsigned maxConfidence = 3;
+		static const unsigned confidenceThreshold = 2;
+
+		//direct mapped on the pc
+		std::vector<Entry> table;
+
+	public:
+		BCStridePrefetcher(unsigned block_size, unsigned degree, unsigned table_entries);
+
+		void notify(Addr block_addr, Addr pc, bool has_pc, bool miss,
+			std::vector<Addr> &addresses) override;
+};
+
+//Stream buffers. A miss next to the last miss of a stream confirms its direction, after which each
+//miss that continues the stream fetches the degree blocks ahead of it. Streams are replaced in LRU
+//order
+class BCStreamPrefetcher : public BCPrefetcher
+{
+	private:
+		struct Stream
+		{
+			bool valid;
+			//last block of the stream which was demanded
+			Addr lastBlock;
+			//+1 or -1 once confirmed, 0 while the stream is training
+			int dir;
+			uint64_t lastUse;
+		};
+
+		std::vector<Stream> streams;
+		uint64_t useCount;
+
+	public:
+		BCStreamPrefetcher(unsigned block_size, unsigned degree, unsigned num_streams);
+
+		void notify(Addr block_addr, Addr pc, bool has_pc, bool miss,
+			std::vector<Addr> &addresses) override;
+};
+
+#endif
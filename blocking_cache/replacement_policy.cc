@@ -0,0 +1,209 @@
+#include "learning_gem5/blocking_cache/replacement_policy.hh"
+
+#include <algorithm>
+
+#include "base/bitfield.hh"
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/random.hh"
+
+void BCReplacementPolicy::init(unsigned num_sets, unsigned assoc)
+{
+	fatal_if(assoc > 64, "Replacement policies support at most 64 ways\n");
+	numSets = num_sets;
+	this->assoc = assoc;
+}
+
+BCReplacementPolicy* BCReplacementPolicy::create(BCReplPolicy policy, unsigned rrpv_bits,
+	unsigned btp)
+{
+	switch(policy)
+	{
+		case BCReplPolicy::LRU:
+			return new BCLRUPolicy();
+		case BCReplPolicy::TreePLRU:
+			return new BCTreePLRUPolicy();
+		case BCReplPolicy::SRRIP:
+			return new BCRRIPPolicy(rrpv_bits, 100);
+		case BCReplPolicy::BRRIP:
+			return new BCRRIPPolicy(rrpv_bits, btp);
+		case BCReplPolicy::Random:
+			return new BCRandomPolicy();
+		default:
+			panic("Unknown replacement policy\n");
+	}
+}
+
+std::string BCReplacementPolicy::policyName(BCReplPolicy policy)
+{
+	switch(policy)
+	{
+		case BCReplPolicy::LRU:
+			return "LRU";
+		case BCReplPolicy::TreePLRU:
+			return "TreePLRU";
+		case BCReplPolicy::SRRIP:
+			return "SRRIP";
+		case BCReplPolicy::BRRIP:
+			return "BRRIP";
+		case BCReplPolicy::Random:
+			return "Random";
+		default:
+			panic("Unknown replacement policy\n");
+	}
+}
+
+void BCLRUPolicy::init(unsigned num_sets, unsigned assoc)
+{
+	BCReplacementPolicy::init(num_sets, assoc);
+	lastTouch.assign(num_sets * assoc, 0);
+}
+
+void BCLRUPolicy::touch(unsigned set, unsigned way)
+{
+	lastTouch[set * assoc + way] = ++timestamp;
+}
+
+void BCLRUPolicy::reset(unsigned set, unsigned way)
+{
+	lastTouch[set * assoc + way] = ++timestamp;
+}
+
+void BCLRUPolicy::invalidate(unsigned set, unsigned way)
+{
+	lastTouch[set * assoc + way] = 0;
+}
+
+unsigned BCLRUPolicy::getVictim(unsigned set, uint64_t excluded)
+{
+	const uint64_t *stamps = &lastTouch[set * assoc];
+	unsigned victim = assoc;
+	for(unsigned way=0; way<assoc; way++)
+	{
+		if(bits(excluded, way))
+			continue;
+		if(victim == assoc || stamps[way] < stamps[victim])
+			victim = way;
+	}
+	assert(victim < assoc);
+	return victim;
+}
+
+void BCTreePLRUPolicy::init(unsigned num_sets, unsigned assoc)
+{
+	fatal_if(!isPowerOf2(assoc), "TreePLRU needs a power of 2 associativity\n");
+	BCReplacementPolicy::init(num_sets, assoc);
+	tree.assign(num_sets * assoc, false);
+}
+
+void BCTreePLRUPolicy::protect(unsigned set, unsigned way)
+{
+	//walk from the leaf of way up to the root, every parent points to the other child
+	unsigned base = set * assoc;
+	unsigned node = assoc + way;
+	while(node > 1)
+	{
+		//a left child (even node) makes its parent point right (true)
+		tree[base + node / 2] = (node % 2 == 0);
+		node /= 2;
+	}
+}
+
+unsigned BCTreePLRUPolicy::getVictim(unsigned set, uint64_t excluded)
+{
+	//follow the bits from the root down to a leaf. Where the subtree a bit points to only holds
+	//excluded ways, take the other one. The subtree of node covers ways [first, first+width)
+	unsigned base = set * assoc;
+	uint64_t allowed = ~excluded;
+	unsigned node = 1;
+	unsigned first = 0;
+	unsigned width = assoc;
+	while(node < assoc)
+	{
+		width /= 2;
+		bool right = tree[base + node];
+		unsigned child_first = right ? first + width : first;
+		if(bits(allowed, child_first + width - 1, child_first) == 0)
+		{
+			right = !right;
+			child_first = right ? first + width : first;
+		}
+		node = 2 * node + (right ? 1 : 0);
+		first = child_first;
+	}
+	assert(bits(allowed, node - assoc));
+	return node - assoc;
+}
+
+BCRRIPPolicy::BCRRIPPolicy(unsigned rrpv_bits, unsigned btp) :
+	maxRRPV((1 << rrpv_bits) - 1),
+	btp(btp)
+	{
+		fatal_if(rrpv_bits == 0 || rrpv_bits > 8, "RRIP needs between 1 and 8 RRPV bits\n");
+	}
+
+void BCRRIPPolicy::init(unsigned num_sets, unsigned assoc)
+{
+	BCReplacementPolicy::init(num_sets, assoc);
+	rrpv.assign(num_sets * assoc, maxRRPV);
+}
+
+void BCRRIPPolicy::touch(unsigned set, unsigned way)
+{
+	//hit priority: predicted to be re-referenced in the near future
+	rrpv[set * assoc + way] = 0;
+}
+
+void BCRRIPPolicy::reset(unsigned set, unsigned way)
+{
+	//long re-reference interval, or distant for most bimodal fills
+	if(btp >= 100 || random_mt.random<unsigned>(0, 99) < btp)
+		rrpv[set * assoc + way] = maxRRPV - 1;
+	else
+		rrpv[set * assoc + way] = maxRRPV;
+}
+
+void BCRRIPPolicy::invalidate(unsigned set, unsigned way)
+{
+	rrpv[set * assoc + way] = maxRRPV;
+}
+
+unsigned BCRRIPPolicy::getVictim(unsigned set, uint64_t excluded)
+{
+	uint8_t *values = &rrpv[set * assoc];
+
+	//the victim is the first block with a distant interval. If there is none, every block is aged by
+	//the amount the oldest one lacks, which is the same as repeating the search until one is found.
+	//Excluded blocks are aged with the rest, saturating at the distant interval, but are never chosen
+	unsigned victim = assoc;
+	for(unsigned way=0; way<assoc; way++)
+	{
+		if(bits(excluded, way))
+			continue;
+		if(victim == assoc || values[way] > values[victim])
+			victim = way;
+	}
+	assert(victim < assoc);
+
+	uint8_t age = maxRRPV - values[victim];
+	if(age > 0)
+	{
+		for(unsigned way=0; way<assoc; way++)
+			values[way] = std::min<unsigned>(values[way] + age, maxRRPV);
+	}
+	return victim;
+}
+
+unsigned BCRandomPolicy::getVictim(unsigned set, uint64_t excluded)
+{
+	//pick the n-th of the ways which are not excluded
+	uint64_t allowed = ~excluded & mask(assoc);
+	assert(allowed != 0);
+	unsigned n = random_mt.random<unsigned>(0, popCount(allowed) - 1);
+	for(unsigned way=0; way<assoc; way++)
+	{
+		if(bits(allowed, way) && n-- == 0)
+			return way;
+	}
+	panic("No way left to evict\n");
+}
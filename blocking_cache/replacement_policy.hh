@@ -0,0 +1,106 @@
+#ifndef __LEARNING_GEM5_BLOCKING_CACHE_REPLACEMENT_POLICY_HH__
+#define __LEARNING_GEM5_BLOCKING_CACHE_REPLACEMENT_POLICY_HH__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "enums/BCReplPolicy.hh"
+
+//Replacement policy interface used by BCTagArray. Policies keep their own state in flat arrays indexed
+//by set*assoc+way, so the tag array stays policy agnostic and no per-block allocation is needed.
+//Ways are passed to getVictim as a bit mask, so the associativity is limited to 64
+class BCReplacementPolicy
+{
+	protected:
+		unsigned numSets;
+		unsigned assoc;
+
+	public:
+		BCReplacementPolicy() : numSets(0), assoc(0) {}
+		virtual ~BCReplacementPolicy() {}
+
+		//called once by the tag array, sizes the replacement state
+		virtual void init(unsigned num_sets, unsigned assoc);
+
+		//block (set, way) was accessed
+		virtual void touch(unsigned set, unsigned way) = 0;
+		//block (set, way) was filled
+		virtual void reset(unsigned set, unsigned way) = 0;
+		//block (set, way) was invalidated
+		virtual void invalidate(unsigned set, unsigned way) {}
+		//returns the way to evict from a set in which every way is valid. Ways whose bit is set in
+		//excluded can not be evicted, at least one way must be left
+		virtual unsigned getVictim(unsigned set, uint64_t excluded) = 0;
+
+		//builds the policy selected in BlockingCache.py. rrpv_bits and btp are only used by RRIP
+		static BCReplacementPolicy *create(BCReplPolicy policy, unsigned rrpv_bits,
+			unsigned btp);
+		//name of a policy as it is written in BlockingCache.py
+		static std::string policyName(BCReplPolicy policy);
+};
+
+//True LRU, every block holds the value of a counter incremented on each access
+class BCLRUPolicy : public BCReplacementPolicy
+{
+	private:
+		std::vector<uint64_t> lastTouch;
+		uint64_t timestamp;
+
+	public:
+		BCLRUPolicy() : timestamp(0) {}
+
+		void init(unsigned num_sets, unsigned assoc) override;
+		void touch(unsigned set, unsigned way) override;
+		void reset(unsigned set, unsigned way) override;
+		void invalidate(unsigned set, unsigned way) override;
+		unsigned getVictim(unsigned set, uint64_t excluded) override;
+};
+
+//Tree pseudo LRU, assoc-1 bits per set. Every bit points to the half of its subtree to evict from
+class BCTreePLRUPolicy : public BCReplacementPolicy
+{
+	private:
+		//numSets * assoc bits, node 0 of each set is unused and the tree is rooted at node 1
+		std::vector<bool> tree;
+
+		//points every node on the way to (set, way) away from it
+		void protect(unsigned set, unsigned way);
+
+	public:
+		void init(unsigned num_sets, unsigned assoc) override;
+		void touch(unsigned set, unsigned way) override { protect(set, way); }
+		void reset(unsigned set, unsigned way) override { protect(set, way); }
+		unsigned getVictim(unsigned set, uint64_t excluded) override;
+};
+
+//Re-Reference Interval Prediction (Jaleel et al., ISCA 2010). Static RRIP inserts with a long
+//re-reference interval, bimodal RRIP inserts with a distant one except for btp percent of fills
+class BCRRIPPolicy : public BCReplacementPolicy
+{
+	private:
+		const uint8_t maxRRPV;
+		//percentage of fills inserted with a long rather than distant interval, 100 for SRRIP
+		const unsigned btp;
+		std::vector<uint8_t> rrpv;
+
+	public:
+		BCRRIPPolicy(unsigned rrpv_bits, unsigned btp);
+
+		void init(unsigned num_sets, unsigned assoc) override;
+		void touch(unsigned set, unsigned way) override;
+		void reset(unsigned set, unsigned way) override;
+		void invalidate(unsigned set, unsigned way) override;
+		unsigned getVictim(unsigned set, uint64_t excluded) override;
+};
+
+//Uniformly random way, no state
+class BCRandomPolicy : public BCReplacementPolicy
+{
+	public:
+		void touch(unsigned set, unsigned way) override {}
+		void reset(unsigned set, unsigned way) override {}
+		unsigned getVictim(unsigned set, uint64_t excluded) override;
+};
+
+#endif
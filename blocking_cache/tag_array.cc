@@ -0,0 +1,161 @@
+#include "learning_gem5/blocking_cache/tag_array.hh"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "base/bitfield.hh"
+#include "base/intmath.hh"
+#include "base/logging.hh"
+
+//alignment of the data arena, a host cache line
+static const size_t arenaAlign = 64;
+
+BCTagArray::BCTagArray(unsigned size, unsigned block_size, unsigned assoc,
+	BCReplacementPolicy *repl_policy) :
+	blockSize(block_size),
+	assoc(assoc),
+	numSets(size / (block_size * assoc)),
+	setShift(floorLog2(block_size)),
+	setMask(numSets - 1),
+	blocks(size / block_size),
+	dataArena(nullptr),
+	replPolicy(repl_policy)
+	{
+		fatal_if(assoc == 0, "Cache associativity must be at least 1\n");
+		fatal_if(!isPowerOf2(blockSize), "Cache block size must be a power of 2\n");
+		fatal_if(size % (block_size * assoc) != 0, "Cache size must be a multiple of block size * assoc\n");
+		fatal_if(numSets == 0 || !isPowerOf2(numSets), "Number of sets (%d) must be a power of 2\n", numSets);
+
+		//one allocation for the whole data array, blocks index into it
+		if(posix_memalign((void**)&dataArena, arenaAlign, size) != 0)
+			fatal("Could not allocate %d bytes of cache data\n", size);
+		memset(dataArena, 0, size);
+
+		for(unsigned i=0; i<blocks.size(); i++)
+		{
+			blocks[i].tag = 0;
+			blocks[i].valid = false;
+			blocks[i].dirty = false;
+			blocks[i].prefetched = false;
+			blocks[i].validSectors = 0;
+			blocks[i].dirtySectors = 0;
+			blocks[i].filling = false;
+			blocks[i].data = dataArena + i * blockSize;
+		}
+
+		replPolicy->init(numSets, assoc);
+	}
+
+BCTagArray::~BCTagArray()
+{
+	free(dataArena);
+}
+
+BCBlock* BCTagArray::findBlock(Addr block_addr)
+{
+	BCBlock *set = getSet(block_addr);
+	for(unsigned way=0; way<assoc; way++)
+	{
+		if(set[way].valid && set[way].tag == block_addr)
+			return &set[way];
+	}
+	return nullptr;
+}
+
+BCBlock* BCTagArray::findVictim(Addr block_addr)
+{
+	BCBlock *set = getSet(block_addr);
+	for(unsigned way=0; way<assoc; way++)
+	{
+		if(!set[way].valid)
+			return &set[way];
+	}
+	//set full, let the replacement policy choose among the blocks which are not being filled
+	uint64_t filling = 0;
+	for(unsigned way=0; way<assoc; way++)
+	{
+		if(set[way].filling)
+			filling |= 1ULL << way;
+	}
+	if(filling == mask(assoc))
+		return nullptr;
+	return &set[replPolicy->getVictim(extractSet(block_addr), filling)];
+}
+
+void BCTagArray::touch(BCBlock *blk)
+{
+	replPolicy->touch(getSetIndex(blk), getWay(blk));
+}
+
+void BCTagArray::insertBlock(BCBlock *blk, Addr block_addr)
+{
+	assert(!blk->valid);
+	assert(getSetIndex(blk) == extractSet(block_addr));
+	blk->tag = block_addr;
+	blk->valid = true;
+	blk->dirty = false;
+	blk->prefetched = false;
+	blk->validSectors = ~0ULL;
+	blk->dirtySectors = 0;
+	blk->filling = false;
+	replPolicy->reset(getSetIndex(blk), getWay(blk));
+}
+
+void BCTagArray::serialize(CheckpointOut &cp) const
+{
+	std::vector<Addr> tag_vec(blocks.size());
+	std::vector<uint8_t> valid_vec(blocks.size());
+	std::vector<uint8_t> dirty_vec(blocks.size());
+	for(unsigned i=0; i<blocks.size(); i++)
+	{
+		tag_vec[i] = blocks[i].tag;
+		valid_vec[i] = blocks[i].valid;
+		dirty_vec[i] = blocks[i].dirty;
+	}
+
+	paramOut(cp, "numSets", numSets);
+	paramOut(cp, "assoc", assoc);
+	paramOut(cp, "blockSize", blockSize);
+	arrayParamOut(cp, "tags", tag_vec);
+	arrayParamOut(cp, "valid", valid_vec);
+	arrayParamOut(cp, "dirty", dirty_vec);
+	arrayParamOut(cp, "data", dataArena, blocks.size() * blockSize);
+}
+
+void BCTagArray::unserialize(CheckpointIn &cp)
+{
+	unsigned num_sets, cpt_assoc, block_size;
+	paramIn(cp, "numSets", num_sets);
+	paramIn(cp, "assoc", cpt_assoc);
+	paramIn(cp, "blockSize", block_size);
+	fatal_if(num_sets != numSets || cpt_assoc != assoc || block_size != blockSize,
+		"Checkpointed cache geometry (%d sets, %d ways, %dB blocks) does not match\n",
+		num_sets, cpt_assoc, block_size);
+
+	std::vector<Addr> tag_vec;
+	std::vector<uint8_t> valid_vec;
+	std::vector<uint8_t> dirty_vec;
+	arrayParamIn(cp, "tags", tag_vec);
+	arrayParamIn(cp, "valid", valid_vec);
+	arrayParamIn(cp, "dirty", dirty_vec);
+	arrayParamIn(cp, "data", dataArena, blocks.size() * blockSize);
+
+	for(unsigned i=0; i<blocks.size(); i++)
+	{
+		blocks[i].valid = false;
+		if(valid_vec[i])
+		{
+			insertBlock(&blocks[i], tag_vec[i]);
+			blocks[i].dirty = dirty_vec[i];
+			blocks[i].dirtySectors = dirty_vec[i] ? ~0ULL : 0;
+		}
+	}
+}
+
+void BCTagArray::invalidate(BCBlock *blk)
+{
+	blk->valid = false;
+	blk->dirty = false;
+	blk->filling = false;
+	replPolicy->invalidate(getSetIndex(blk), getWay(blk));
+}
@@ -0,0 +1,121 @@
+#ifndef __LEARNING_GEM5_BLOCKING_CACHE_TAG_ARRAY_HH__
+#define __LEARNING_GEM5_BLOCKING_CACHE_TAG_ARRAY_HH__
+
+#include <memory>
+#include <vector>
+
+#include "base/types.hh"
+#include "sim/serialize.hh"
+#include "learning_gem5/blocking_cache/replacement_policy.hh"
+
+//One way of one set. The data pointer points into the arena owned by the tag array, so a block never
+//owns memory of its own
+struct BCBlock
+{
+	//block aligned address of the data held, only meaningful when valid is set
+	Addr tag;
+	bool valid;
+	//set by writes, the block has to be written back when evicted
+	bool dirty;
+	//filled by a prefetch and not demanded yet
+	bool prefetched;
+	//per sector valid and dirty bits, bit i for sector i. Blocks of an unsectored cache are one sector
+	uint64_t validSectors;
+	uint64_t dirtySectors;
+	//sectors of the block are still being fetched, the block can not be chosen as a victim
+	bool filling;
+	uint8_t *data;
+};
+
+//Set associative tag array. Tags of a set are stored next to each other, and the data of every block
+//lives in a single preallocated arena of size bytes, aligned to the host cache line, in the same order
+//as the tags. Lookups and fills never allocate. Victims are chosen by a BCReplacementPolicy.
+class BCTagArray
+{
+	private:
+		const unsigned blockSize;
+		const unsigned assoc;
+		const unsigned numSets;
+
+		//log2(blockSize), shift to get from an address to its set index
+		const unsigned setShift;
+		const Addr setMask;
+
+		//numSets * assoc blocks, set i occupies [i*assoc, (i+1)*assoc)
+		std::vector<BCBlock> blocks;
+
+		//data storage for all blocks
+		uint8_t *dataArena;
+
+		//chooses victims in full sets, owned by the tag array
+		std::unique_ptr<BCReplacementPolicy> replPolicy;
+
+	public:
+		BCTagArray(unsigned size, unsigned block_size, unsigned assoc, BCReplacementPolicy *repl_policy);
+		~BCTagArray();
+
+		BCTagArray(const BCTagArray&) = delete;
+		BCTagArray& operator=(const BCTagArray&) = delete;
+
+		//set index of a block address
+		unsigned extractSet(Addr block_addr) const
+		{
+			return (block_addr >> setShift) & setMask;
+		}
+
+		//returns the first way of the set block_addr maps to
+		BCBlock *getSet(Addr block_addr)
+		{
+			return &blocks[extractSet(block_addr) * assoc];
+		}
+
+		//returns the valid block holding block_addr, nullptr on a miss
+		BCBlock *findBlock(Addr block_addr);
+
+		//returns the block to be filled with block_addr. An invalid way is used if the set has one,
+		//otherwise the replacement policy picks a valid victim, which the caller has to write back
+		//before inserting. Blocks being filled are never returned, nullptr if every way is filling
+		BCBlock *findVictim(Addr block_addr);
+
+		//updates the replacement state of blk after an access
+		void touch(BCBlock *blk);
+
+		//marks blk as holding block_addr, with every sector valid and clean
+		void insertBlock(BCBlock *blk, Addr block_addr);
+
+		void invalidate(BCBlock *blk);
+
+		unsigned getAssoc() const { return assoc; }
+		unsigned getNumSets() const { return numSets; }
+		unsigned getNumBlocks() const { return blocks.size(); }
+
+		//applies fn to every valid block
+		template <typename F>
+		void forEachValid(F fn)
+		{
+			for(auto &blk: blocks)
+			{
+				if(blk.valid)
+					fn(&blk);
+			}
+		}
+
+		//saves/restores tags, state bits and data. Replacement state is not saved, restored blocks
+		//start from a freshly filled state
+		void serialize(CheckpointOut &cp) const;
+		void unserialize(CheckpointIn &cp);
+
+		//way of blk within its set
+		unsigned getWay(const BCBlock *blk) const
+		{
+			return (blk - blocks.data()) % assoc;
+		}
+
+		//set of blk
+		unsigned getSetIndex(const BCBlock *blk) const
+		{
+			return (blk - blocks.data()) / assoc;
+		}
+};
+
+#endif
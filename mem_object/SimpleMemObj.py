@@ -10,3 +10,5 @@ class SimpleMemObj(SimObject):
 	data_port = SlavePort("CPU side dport, receives req")
 
 	mem_port = MasterPort("Mem side port, sends requests")
+
+	max_outstanding = Param.Unsigned(1, "Requests each CPU side port can have in flight to memory at once")
@@ -4,11 +4,25 @@
 
 SimpleMemObj::SimpleMemObj(SimpleMemObjParams *params) :
 	SimObject(params),
-	instPort(params->name + ".inst_port", this),
-	dataPort(params->name + ".data_port", this),
+	instPort(params->name + ".inst_port", 0, this),
+	dataPort(params->name + ".data_port", 1, this),
 	memPort(params->name + ".mem_port", this),
-	blocked(false)
-	{}
+	maxOutstanding(params->max_outstanding)
+	{
+		fatal_if(maxOutstanding == 0, "SimpleMemObj needs at least one outstanding request\n");
+		inFlight.reserve(2 * maxOutstanding);
+	}
+
+unsigned SimpleMemObj::outstanding(const CPUSidePort *port) const
+{
+	unsigned count = 0;
+	for(const InFlight &entry: inFlight)
+	{
+		if(entry.port == port)
+			count++;
+	}
+	return count;
+}
 
 Port& SimpleMemObj::getPort(const std::string& if_name, PortID idx)
 {
@@ -37,6 +51,16 @@ void SimpleMemObj::handleFunctional(PacketPtr pkt)
 	memPort.sendFunctional(pkt);
 }
 
+Tick CPUSidePort::recvAtomic(PacketPtr pkt)
+{
+	return owner->handleAtomic(pkt);
+}
+
+Tick SimpleMemObj::handleAtomic(PacketPtr pkt)
+{
+	return memPort.sendAtomic(pkt);
+}
+
 AddrRangeList SimpleMemObj::getAddrRanges() const
 {
 	return memPort.getAddrRanges();
@@ -55,7 +79,7 @@ void SimpleMemObj::sendRangeChange()
 
 bool CPUSidePort::recvTimingReq(PacketPtr pkt)
 {
-	if(!owner->handleRequest(pkt))
+	if(!owner->handleRequest(pkt, this))
 	{
 		needRetry = true;
 		return false;
@@ -63,17 +87,33 @@ bool CPUSidePort::recvTimingReq(PacketPtr pkt)
 	return true;
 }
 
-bool SimpleMemObj::handleRequest(PacketPtr pkt)
+bool SimpleMemObj::handleRequest(PacketPtr pkt, CPUSidePort *port)
 {
-	if(blocked)
+	//backpressure: all slots of this port used, or memory has not taken the last request yet
+	if(!canAcceptRequest(port))
 		return false;
 	
 	DPRINTF(SimpleMemObj, "Got request for addr: %x\n", pkt->getAddr());
-	blocked = true;
+	//requests without a response are not tracked, there is nothing to route back
+	if(pkt->needsResponse())
+		inFlight.push_back({pkt, port});
 	memPort.sendPacket(pkt);
 	return true;
 }
 
+void SimpleMemObj::trySendRetries()
+{
+	if(canAcceptRequest(&instPort))
+		instPort.trySendRetry();
+	if(canAcceptRequest(&dataPort))
+		dataPort.trySendRetry();
+}
+
+void SimpleMemObj::handleReqRetry()
+{
+	trySendRetries();
+}
+
 void MemSidePort::sendPacket(PacketPtr pkt)
 {
 	panic_if(blockedPacket != nullptr, "Don't send when receiver blocked!");
@@ -89,6 +129,8 @@ void MemSidePort::recvReqRetry()
 	blockedPacket = nullptr;
 
 	sendPacket(ptr);
+	if(blockedPacket == nullptr)
+		owner->handleReqRetry();
 }
 
 bool MemSidePort::recvTimingResp(PacketPtr pkt)
@@ -98,25 +140,32 @@ bool MemSidePort::recvTimingResp(PacketPtr pkt)
 
 bool SimpleMemObj::handleResponse(PacketPtr pkt)
 {
-	assert(blocked);
 	DPRINTF(SimpleMemObj, "Out resp for addr: %x\n", pkt->getAddr());
 
-	blocked = false;
+	//the response is the request packet turned around, send it back where it came from
+	auto it = inFlight.begin();
+	while(it != inFlight.end() && it->pkt != pkt)
+		it++;
+	panic_if(it == inFlight.end(), "Response for a packet which is not in flight\n");
 
-	if(pkt->req->isInstFetch())
-		instPort.sendPacket(pkt);
-	else
-		dataPort.sendPacket(pkt);
-	
-	instPort.trySendRetry();
-	dataPort.trySendRetry();
+	CPUSidePort *port = it->port;
+	*it = inFlight.back();
+	inFlight.pop_back();
+
+	port->sendPacket(pkt);
+	trySendRetries();
 
 	return true;
 }
 
 void CPUSidePort::sendPacket(PacketPtr pkt)
 {
-	panic_if(blockedPacket != nullptr, "dont send when blocked\n");
+	//a response is already waiting for the master, queue behind it
+	if(blockedPacket != nullptr)
+	{
+		respQueue.push_back(pkt);
+		return;
+	}
 	if(!sendTimingResp(pkt))
 		blockedPacket = pkt;
 }
@@ -129,6 +178,16 @@ void CPUSidePort::recvRespRetry()
 	blockedPacket = nullptr;
 
 	sendPacket(ptr);
+	while(blockedPacket == nullptr && !respQueue.empty())
+	{
+		ptr = respQueue.front();
+		respQueue.pop_front();
+		sendPacket(ptr);
+	}
+
+	//a retry owed to the master was held back while its response was blocked
+	if(blockedPacket == nullptr && owner->canAcceptRequest(this))
+		trySendRetry();
 }
 
 void CPUSidePort::trySendRetry()
@@ -1,6 +1,7 @@
 #ifndef __LEARNING_GEM5_MEM_OBJECT_SIMPLE_MEMOBJ_HH__
 #define __LEARNING_GEM5_MEM_OBJECT_SIMPLE_MEMOBJ_HH__
 
+#include <deque>
 #include <vector>
 
 #include "mem/port.hh"
@@ -12,12 +13,16 @@ class CPUSidePort : public SlavePort
 	private:
 		SimpleMemObj *owner;
 		PacketPtr blockedPacket;
+		//responses which arrived while blockedPacket waits for the master, at most one per
+		//outstanding request
+		std::deque<PacketPtr> respQueue;
 		bool needRetry;
+		int id;
 
 	public:
-		CPUSidePort(const std::string& name, SimpleMemObj* owner) :
+		CPUSidePort(const std::string& name, int id, SimpleMemObj* owner) :
 			SlavePort(name, (SimObject*) owner), owner(owner), blockedPacket(nullptr),
-			needRetry(false)
+			needRetry(false), id(id)
 			{}
 
 		AddrRangeList getAddrRanges() const override;
@@ -25,7 +30,7 @@ class CPUSidePort : public SlavePort
 		void trySendRetry();
 
 	protected:
-		Tick recvAtomic(PacketPtr pkt) override { panic("recvAtomic	unimplemented");}
+		Tick recvAtomic(PacketPtr pkt) override;
 		void recvFunctional(PacketPtr pkt) override;
 		bool recvTimingReq(PacketPtr pkt) override;
 		void recvRespRetry() override;
@@ -42,6 +47,8 @@ class MemSidePort : public MasterPort
 			MasterPort(name, (SimObject*) owner), owner(owner), blockedPacket(nullptr)
 			{}
 		void sendPacket(PacketPtr pkt);
+		//true while a request waits for a retry from the slave
+		bool isBlocked() const { return blockedPacket != nullptr; }
 
 	protected:
 		bool recvTimingResp(PacketPtr pkt) override;
@@ -52,21 +59,47 @@ class MemSidePort : public MasterPort
 class SimpleMemObj: public SimObject
 {
 	private:
+		//a request forwarded to memPort, and the port its response goes back to
+		struct InFlight
+		{
+			PacketPtr pkt;
+			CPUSidePort *port;
+		};
+
 		CPUSidePort instPort;
 		CPUSidePort dataPort;
 
 		MemSidePort memPort;
 		
-		bool blocked;
+		//requests each CPU side port can have in flight to memory at once, so neither port can take
+		//the slots of the other
+		const unsigned maxOutstanding;
+		//requests forwarded and not responded to yet, of both ports. Small, so searched linearly
+		std::vector<InFlight> inFlight;
+
+		//number of entries of inFlight which belong to port
+		unsigned outstanding(const CPUSidePort *port) const;
+
+		//sends retries to the ports turned away while no request could be accepted
+		void trySendRetries();
 		
 	public:
 		SimpleMemObj(SimpleMemObjParams *params);
 
 		Port &getPort(const std::string &if_name, PortID idx = InvalidPortID) override;
 
-		bool handleRequest(PacketPtr pkt);
+		//false while every slot of port is in use or memory has not taken the last request yet
+		bool canAcceptRequest(const CPUSidePort *port) const
+		{
+			return outstanding(port) < maxOutstanding && !memPort.isBlocked();
+		}
+
+		bool handleRequest(PacketPtr pkt, CPUSidePort *port);
 		bool handleResponse(PacketPtr pkt);
+		//called by memPort once a request waiting for a retry has been sent
+		void handleReqRetry();
 		void handleFunctional(PacketPtr pkt);
+		Tick handleAtomic(PacketPtr pkt);
 		AddrRangeList getAddrRanges() const;
 
 
@@ -1,4 +1,24 @@
-from m5.objects import Cache
+from m5.objects import Cache, BlockingCache
+
+def setCacheOptions(cache, options, level):
+	"""Apply the --<level>_assoc, --<level>_mshrs and --<level>_latency options, a
+	classic Cache gets the latency for its tags, data and response alike"""
+	if not options:
+		return
+	assoc = getattr(options, level + '_assoc', None)
+	if assoc:
+		cache.assoc = assoc
+	mshrs = getattr(options, level + '_mshrs', None)
+	if mshrs:
+		cache.mshrs = mshrs
+	latency = getattr(options, level + '_latency', None)
+	if latency:
+		if isinstance(cache, BlockingCache):
+			cache.latency = latency
+		else:
+			cache.tag_latency = latency
+			cache.data_latency = latency
+			cache.response_latency = latency
 
 class L1Cache(Cache):
 	assoc = 2
@@ -10,7 +30,7 @@ class L1Cache(Cache):
 
 	def __init__(self, options=None):
 		super(L1Cache, self).__init__()
-		pass
+		setCacheOptions(self, options, 'l1')
 	
 	def connectCPU(self, cpu):
 		raise NotImplementedError
@@ -49,6 +69,7 @@ class L2Cache(Cache):
 
 	def __init__(self, options):
 		super(L2Cache, self).__init__()
+		setCacheOptions(self, options, 'l2')
 		if not options or not options.l2_size:
 			return
 		self.size = options.l2_size
@@ -58,3 +79,44 @@ class L2Cache(Cache):
 	
 	def connectMemSideBus(self, bus):
 		self.mem_side = bus.slave
+
+# L1 caches built from the learning_gem5 BlockingCache, selected with
+# --cache_type=blocking in two_level.py. The L2 stays an L2Cache: the L1s send it
+# their evictions as WritebackDirty and CleanEvict, which a BlockingCache can not
+# take, it only answers requests which need a response
+class BlockingL1Cache(BlockingCache):
+	assoc = 2
+	latency = 2
+	mshrs = 4
+	tgts_per_mshr = 20
+
+	def __init__(self, options=None):
+		super(BlockingL1Cache, self).__init__()
+		setCacheOptions(self, options, 'l1')
+
+	def connectCPU(self, cpu):
+		raise NotImplementedError
+
+	def connectBus(self, bus):
+		self.mem_side = bus.slave
+
+class BlockingL1ICache(BlockingL1Cache):
+
+	def __init__(self, options):
+		super(BlockingL1ICache, self).__init__(options)
+		if not options or not options.l1i_size:
+			return
+		self.size = options.l1i_size
+
+	def connectCPU(self, cpu):
+		self.cpu_side = cpu.icache_port
+
+class BlockingL1DCache(BlockingL1Cache):
+	def __init__(self, options):
+		super(BlockingL1DCache, self).__init__(options)
+		if not options or not options.l1d_size:
+			return
+		self.size = options.l1d_size
+
+	def connectCPU(self, cpu):
+		self.cpu_side = cpu.dcache_port
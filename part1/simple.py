@@ -1,5 +1,16 @@
 import m5
 from m5.objects import *
+from optparse import OptionParser
+
+parser = OptionParser()
+parser.add_option("--cache_size", help="Cache size")
+parser.add_option("--assoc", type="int", help="Cache associativity")
+parser.add_option("--mshrs", type="int", help="Cache MSHRs")
+parser.add_option("--latency", type="int", help="Cache latency in cycles")
+parser.add_option("--cmd", default="tests/test-progs/hello/bin/x86/linux/hello",
+	help="Binary to run")
+
+(options, args) = parser.parse_args()
 
 system = System()
 
@@ -13,6 +24,14 @@ system.mem_ranges = [AddrRange('512MB')]
 system.cpu = TimingSimpleCPU()
 
 system.cache = BlockingCache()
+if options.cache_size:
+	system.cache.size = options.cache_size
+if options.assoc:
+	system.cache.assoc = options.assoc
+if options.mshrs:
+	system.cache.mshrs = options.mshrs
+if options.latency:
+	system.cache.latency = options.latency
 
 system.membus = SystemXBar()
 
@@ -33,7 +52,7 @@ system.mem_ctrl.range = system.mem_ranges[0]
 system.mem_ctrl.port = system.membus.master
 
 process = Process()
-process.cmd = ["tests/test-progs/hello/bin/x86/linux/hello"]
+process.cmd = [options.cmd]
 system.cpu.workload = process
 system.cpu.createThreads()
 
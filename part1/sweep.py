@@ -0,0 +1,114 @@
+# Runs two_level.py or simple.py over the cartesian product of option values, one gem5
+# process per point with up to --jobs of them at once, and collects one CSV row per point.
+# This is a plain python script run on the host, not by gem5, e.g.
+#   python sweep.py --gem5 build/X86/gem5.opt --config two_level.py \
+#     --sweep l1d_size=16kB,32kB,64kB --sweep l2_size=256kB,1MB \
+#     --sweep cache_type=classic,blocking --jobs 8 --csv sweep.csv
+# Every point writes its stats to <outdir>/<point>/stats.txt, failed points keep their
+# exit code in the CSV so that one bad configuration does not lose the whole sweep.
+
+from __future__ import print_function
+
+import argparse
+import csv
+import itertools
+import multiprocessing
+import os
+import subprocess
+import time
+
+# stats.txt entries copied into the CSV
+STATS = ['sim_insts', 'sim_ticks', 'sim_seconds', 'host_inst_rate', 'host_mem_usage']
+
+def parseSweep(sweeps):
+	"""Turn ['a=1,2', 'b=x'] into [('a', ['1', '2']), ('b', ['x'])]"""
+	axes = []
+	for sweep in sweeps:
+		name, _, values = sweep.partition('=')
+		if not values:
+			raise SystemExit("--sweep needs name=value[,value...], got " + sweep)
+		axes.append((name, values.split(',')))
+	return axes
+
+def readStats(path):
+	stats = {}
+	if not os.path.exists(path):
+		return stats
+	with open(path) as f:
+		for line in f:
+			fields = line.split()
+			# only the first dump, later ones would overwrite it
+			if fields and fields[0].startswith('----------') and stats:
+				break
+			if len(fields) >= 2 and fields[0] in STATS:
+				stats[fields[0]] = fields[1]
+	return stats
+
+def runPoint(job):
+	args, point = job
+	name = '_'.join('%s-%s' % (k, v) for k, v in point)
+	outdir = os.path.join(args.outdir, name)
+	cmd = [args.gem5, '--outdir=' + outdir, args.config]
+	cmd += ['--%s=%s' % (k, v) for k, v in point]
+	cmd += args.extra
+
+	start = time.time()
+	with open(os.path.join(args.outdir, name + '.log'), 'w') as log:
+		proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT)
+		# wait4 gives the rusage of this child alone, RUSAGE_CHILDREN would mix
+		# in every point this worker ran before
+		_, status, rusage = os.wait4(proc.pid, 0)
+	host_seconds = time.time() - start
+
+	row = dict(point)
+	row['point'] = name
+	row['exit_code'] = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+	row['host_seconds'] = '%.2f' % host_seconds
+	# kB on Linux
+	row['peak_rss_kB'] = rusage.ru_maxrss
+	row.update(readStats(os.path.join(outdir, 'stats.txt')))
+	if 'sim_insts' in row and host_seconds > 0:
+		row['insts_per_host_second'] = '%.0f' % (float(row['sim_insts']) / host_seconds)
+	print('%s: exit %s in %s s' % (name, row['exit_code'], row['host_seconds']))
+	return row
+
+def main():
+	parser = argparse.ArgumentParser()
+	parser.add_argument('--gem5', default='build/X86/gem5.opt', help="gem5 binary")
+	parser.add_argument('--config', default=os.path.join(os.path.dirname(__file__), 'two_level.py'),
+		help="Config script to sweep, two_level.py or simple.py")
+	parser.add_argument('--sweep', action='append', default=[],
+		help="name=value[,value...], the config option and the values it takes, repeatable")
+	parser.add_argument('--jobs', type=int, default=multiprocessing.cpu_count(),
+		help="Points simulated at once")
+	parser.add_argument('--outdir', default='sweep_out', help="Where every point writes its m5out")
+	parser.add_argument('--csv', default='sweep.csv', help="Collected results")
+	parser.add_argument('extra', nargs=argparse.REMAINDER,
+		help="Options passed unchanged to every point, after --")
+	args = parser.parse_args()
+	if args.extra and args.extra[0] == '--':
+		args.extra = args.extra[1:]
+
+	axes = parseSweep(args.sweep)
+	names = [name for name, _ in axes]
+	points = [list(zip(names, values)) for values in itertools.product(*[v for _, v in axes])]
+	if not os.path.isdir(args.outdir):
+		os.makedirs(args.outdir)
+	print('Sweeping %d points with %d jobs' % (len(points), args.jobs))
+
+	# the workers only wait on gem5, one per host core keeps every core simulating
+	pool = multiprocessing.Pool(args.jobs)
+	rows = pool.map(runPoint, [(args, point) for point in points], chunksize=1)
+	pool.close()
+	pool.join()
+
+	columns = ['point'] + names + ['exit_code', 'host_seconds', 'insts_per_host_second',
+		'peak_rss_kB'] + STATS
+	with open(args.csv, 'w') as f:
+		writer = csv.DictWriter(f, columns, extrasaction='ignore')
+		writer.writeheader()
+		writer.writerows(rows)
+	print('Wrote %s' % args.csv)
+
+if __name__ == '__main__':
+	main()
@@ -7,6 +7,16 @@ parser = OptionParser()
 parser.add_option("--l1d_size", help="L1 DCache size")
 parser.add_option("--l1i_size", help="L1 ICache size")
 parser.add_option("--l2_size", help="L2 Cache size")
+parser.add_option("--l1_assoc", type="int", help="L1 Caches associativity")
+parser.add_option("--l2_assoc", type="int", help="L2 Cache associativity")
+parser.add_option("--l1_mshrs", type="int", help="L1 Caches MSHRs")
+parser.add_option("--l2_mshrs", type="int", help="L2 Cache MSHRs")
+parser.add_option("--l1_latency", type="int", help="L1 Caches latency in cycles")
+parser.add_option("--l2_latency", type="int", help="L2 Cache latency in cycles")
+parser.add_option("--cache_type", type="choice", choices=["classic", "blocking"],
+	default="classic", help="Build the L1 caches from Cache or from BlockingCache")
+parser.add_option("--cmd", default="tests/test-progs/hello/bin/x86/linux/hello",
+	help="Binary to run")
 
 (options, args) = parser.parse_args()
 
@@ -23,8 +33,12 @@ system.cpu = TimingSimpleCPU()
 
 system.membus = SystemXBar()
 
-system.cpu.icache = L1ICache(options)
-system.cpu.dcache = L1DCache(options)
+if options.cache_type == "blocking":
+	system.cpu.icache = BlockingL1ICache(options)
+	system.cpu.dcache = BlockingL1DCache(options)
+else:
+	system.cpu.icache = L1ICache(options)
+	system.cpu.dcache = L1DCache(options)
 
 system.cpu.icache.connectCPU(system.cpu)
 system.cpu.dcache.connectCPU(system.cpu)
@@ -34,6 +48,7 @@ system.l2bus = L2XBar()
 system.cpu.icache.connectBus(system.l2bus)
 system.cpu.dcache.connectBus(system.l2bus)
 
+# the L1 evictions need a classic cache below them, see caches.py
 system.l2cache = L2Cache(options)
 system.l2cache.connectCPUSideBus(system.l2bus)
 system.l2cache.connectMemSideBus(system.membus)
@@ -51,7 +66,7 @@ system.mem_ctrl.range = system.mem_ranges[0]
 system.mem_ctrl.port = system.membus.master
 
 process = Process()
-process.cmd = ["tests/test-progs/hello/bin/x86/linux/hello"]
+process.cmd = [options.cmd]
 system.cpu.workload = process
 system.cpu.createThreads()
 
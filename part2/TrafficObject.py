@@ -0,0 +1,26 @@
+from m5.params import *
+from m5.proxy import *
+from m5.SimObject import SimObject
+
+class TOPattern(ScopedEnum):
+	vals = ['Linear', 'Strided', 'Random', 'PointerChase']
+
+class TrafficObject(SimObject):
+	type = 'TrafficObject'
+	cxx_header = 'learning_gem5/part2/traffic_object.hh'
+
+	port = MasterPort("Sends the generated requests, connect it to a cpu_side port")
+
+	pattern = Param.TOPattern('Linear', "Address pattern of the requests")
+	start_addr = Param.Addr(0, "First address of the range the requests go to")
+	range_size = Param.MemorySize('1MB', "Size of the range the requests go to")
+	request_size = Param.Unsigned(64, "Bytes per request")
+	stride = Param.Unsigned(256, "Bytes between two requests of the Strided pattern")
+	read_percent = Param.Percent(100, "Percentage of reads, the rest are writes")
+
+	interval = Param.Latency('1ns', "Time between two requests, sets the injection rate")
+	max_outstanding = Param.Unsigned(16, "Requests which can wait for their response at once")
+	num_requests = Param.Counter(100000, "Requests to send before exiting the simulation")
+	seed = Param.Unsigned(1, "Seed for the Random and PointerChase patterns and the read/write mix")
+
+	system = Param.System(Parent.any, "The system this generator is part of")
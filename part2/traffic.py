@@ -0,0 +1,79 @@
+# Microbenchmarks for the learning_gem5 memory objects, driven by a TrafficObject
+# instead of a CPU. Run e.g.
+#   build/X86/gem5.opt src/learning_gem5/part2/traffic.py --preset chase --target cache
+# The generator prints the achieved bandwidth, the latency percentiles and the requests
+# simulated per host second, the same numbers end up in m5out/stats.txt.
+
+import argparse
+import time
+
+import m5
+from m5.objects import *
+
+presets = {
+	'linear': dict(pattern = 'Linear'),
+	'strided': dict(pattern = 'Strided', stride = 4096),
+	'random': dict(pattern = 'Random'),
+	'chase': dict(pattern = 'PointerChase', max_outstanding = 1),
+	'mix': dict(pattern = 'Random', read_percent = 70),
+}
+
+parser = argparse.ArgumentParser()
+parser.add_argument('--preset', choices = sorted(presets), default = 'linear')
+parser.add_argument('--target', choices = ['mem', 'memobj', 'cache'], default = 'cache',
+		help = "What the generator drives: the memory controller directly, a SimpleMemObj "
+		"or a BlockingCache")
+parser.add_argument('--range-size', default = '1MB')
+parser.add_argument('--interval', default = '1ns', help = "Time between requests")
+parser.add_argument('--max-outstanding', type = int)
+parser.add_argument('--num-requests', type = int, default = 100000)
+parser.add_argument('--read-percent', type = int)
+parser.add_argument('--seed', type = int, default = 1)
+args = parser.parse_args()
+
+system = System()
+
+system.clk_domain = SrcClockDomain()
+system.clk_domain.clock = '1GHz'
+system.clk_domain.voltage_domain = VoltageDomain()
+
+system.mem_mode = 'timing'
+system.mem_ranges = [AddrRange('512MB')]
+
+system.traffic = TrafficObject(range_size = args.range_size, interval = args.interval,
+		num_requests = args.num_requests, seed = args.seed, **presets[args.preset])
+if args.max_outstanding is not None:
+	system.traffic.max_outstanding = args.max_outstanding
+if args.read_percent is not None:
+	system.traffic.read_percent = args.read_percent
+
+system.membus = SystemXBar()
+
+if args.target == 'cache':
+	system.cache = BlockingCache()
+	system.traffic.port = system.cache.cpu_side
+	system.cache.mem_side = system.membus.slave
+elif args.target == 'memobj':
+	system.memobj = SimpleMemObj()
+	system.traffic.port = system.memobj.inst_port
+	system.memobj.mem_port = system.membus.slave
+else:
+	system.traffic.port = system.membus.slave
+
+system.system_port = system.membus.slave
+
+system.mem_ctrl = DDR3_1600_8x8()
+system.mem_ctrl.range = system.mem_ranges[0]
+system.mem_ctrl.port = system.membus.master
+
+root = Root(full_system = False, system = system)
+m5.instantiate()
+
+print("Beginning simulation: {} traffic to {}".format(args.preset, args.target))
+host_start = time.time()
+exit_event = m5.simulate()
+host_seconds = time.time() - host_start
+
+print("Exiting event @{} because {}".format(m5.curTick(),exit_event.getCause()))
+print("Host seconds {:.2f}, simulated ticks per host second {:.0f}".format(host_seconds,
+		m5.curTick() / host_seconds))
@@ -0,0 +1,236 @@
+#include "learning_gem5/part2/traffic_object.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "debug/TrafficObject.hh"
+#include "sim/sim_exit.hh"
+#include "sim/stats.hh"
+#include "sim/system.hh"
+
+TrafficObject::TrafficObject(TrafficObjectParams *params) :
+	SimObject(params),
+	port(params->name + ".port", this),
+	event([this]{processEvent();}, name()),
+	pattern(params->pattern),
+	startAddr(params->start_addr),
+	rangeSize(params->range_size),
+	requestSize(params->request_size),
+	stride(params->stride),
+	readPercent(params->read_percent),
+	interval(params->interval),
+	maxOutstanding(params->max_outstanding),
+	numRequests(params->num_requests),
+	masterId(params->system->getMasterId(this)),
+	rng(params->seed),
+	sent(0),
+	received(0),
+	outstanding(0),
+	position(0)
+{
+	fatal_if(requestSize == 0 || rangeSize % requestSize != 0,
+					 "TrafficObject range_size must be a multiple of request_size\n");
+	fatal_if(pattern == TOPattern::Strided && (stride == 0 || stride % requestSize != 0),
+					 "TrafficObject stride must be a multiple of request_size\n");
+	//the chase visits the blocks with a full period LCG, which needs a power of two
+	fatal_if(pattern == TOPattern::PointerChase && !isPowerOf2(rangeSize / requestSize),
+					 "TrafficObject PointerChase needs a power of two number of requests in range_size\n");
+	fatal_if(maxOutstanding == 0, "TrafficObject needs at least one outstanding request\n");
+	latencies.reserve(numRequests);
+}
+
+Port& TrafficObject::getPort(const std::string& if_name, PortID idx)
+{
+	if(if_name == "port")
+		return port;
+	else
+		return SimObject::getPort(if_name, idx);
+}
+
+void TrafficObject::startup()
+{
+	hostStart = std::chrono::steady_clock::now();
+	if(numRequests > 0)
+		schedule(event, curTick());
+}
+
+Addr TrafficObject::nextAddr()
+{
+	uint64_t blocks = rangeSize / requestSize;
+	uint64_t offset = 0;
+	switch(pattern)
+	{
+		case TOPattern::Linear:
+			offset = (position++ * requestSize) % rangeSize;
+			break;
+		case TOPattern::Strided:
+			offset = (position++ * stride) % rangeSize;
+			break;
+		case TOPattern::Random:
+			offset = rng.random<uint64_t>(0, blocks - 1) * requestSize;
+			break;
+		case TOPattern::PointerChase:
+			//a = 1 mod 4 and an odd c give a full period modulo a power of two, every block is visited
+			//once per round in an order the caches cannot prefetch
+			offset = position * requestSize;
+			position = (position * 6364136223846793005ULL + 1442695040888963407ULL) & (blocks - 1);
+			break;
+		default:
+			panic("Unknown traffic pattern\n");
+	}
+	return startAddr + offset;
+}
+
+void TrafficObject::processEvent()
+{
+	//sent again by handleResponse/handleReqRetry once there is room
+	if(outstanding >= maxOutstanding || port.isBlocked())
+		return;
+
+	bool is_read = rng.random<unsigned>(0, 99) < readPercent;
+	RequestPtr req(new Request(nextAddr(), requestSize, 0, masterId));
+	PacketPtr pkt = new Packet(req, is_read ? MemCmd::ReadReq : MemCmd::WriteReq);
+	pkt->allocate();
+	if(!is_read)
+		std::memset(pkt->getPtr<uint8_t>(), 0, requestSize);
+
+	DPRINTF(TrafficObject, "Sending %s for addr %#x\n", is_read ? "read" : "write", req->getPaddr());
+	sent++;
+	outstanding++;
+	port.sendPacket(pkt);
+
+	if(sent < numRequests && pattern != TOPattern::PointerChase)
+		schedule(event, curTick() + interval);
+}
+
+void TrafficPort::sendPacket(PacketPtr pkt)
+{
+	panic_if(blockedPacket != nullptr, "Don't send when receiver blocked!");
+	if(!sendTimingReq(pkt))
+		blockedPacket = pkt;
+}
+
+void TrafficPort::recvReqRetry()
+{
+	assert(blockedPacket != nullptr);
+
+	PacketPtr ptr = blockedPacket;
+	blockedPacket = nullptr;
+
+	sendPacket(ptr);
+	if(blockedPacket == nullptr)
+		owner->handleReqRetry();
+}
+
+void TrafficObject::handleReqRetry()
+{
+	//a send event which found the port blocked did not reschedule itself
+	if(sent < numRequests && !event.scheduled() && pattern != TOPattern::PointerChase)
+		schedule(event, curTick());
+}
+
+bool TrafficPort::recvTimingResp(PacketPtr pkt)
+{
+	return owner->handleResponse(pkt);
+}
+
+bool TrafficObject::handleResponse(PacketPtr pkt)
+{
+	Tick lat = curTick() - pkt->req->time();
+	DPRINTF(TrafficObject, "Response for addr %#x after %d ticks\n", pkt->getAddr(), lat);
+
+	latency.sample(lat);
+	latencies.push_back(lat);
+	if(pkt->isRead())
+	{
+		reads++;
+		bytesRead += pkt->getSize();
+	}
+	else
+	{
+		writes++;
+		bytesWritten += pkt->getSize();
+	}
+	delete pkt;
+
+	outstanding--;
+	received++;
+
+	if(received == numRequests)
+		finish();
+	//the next chase request needs this response, the others may have waited for a free slot
+	else if(sent < numRequests && !event.scheduled())
+		schedule(event, pattern == TOPattern::PointerChase ? curTick() + interval : curTick());
+
+	return true;
+}
+
+void TrafficObject::finish()
+{
+	std::chrono::duration<double> host = std::chrono::steady_clock::now() - hostStart;
+	hostSeconds = host.count();
+
+	std::sort(latencies.begin(), latencies.end());
+	auto percentile = [this](unsigned p) { return latencies[(latencies.size() - 1) * p / 100]; };
+	Tick p50 = percentile(50), p90 = percentile(90), p99 = percentile(99);
+	latencyP50 = p50;
+	latencyP90 = p90;
+	latencyP99 = p99;
+
+	double sim_seconds = double(curTick()) / SimClock::Frequency;
+	double bytes = bytesRead.value() + bytesWritten.value();
+	inform("%s: %d requests, %.2f MB/s, latency p50 %d p90 %d p99 %d ticks, %.0f requests/host s\n",
+				 name(), received, bytes / sim_seconds / 1e6, p50, p90, p99, received / host.count());
+
+	exitSimLoop("traffic generator done");
+}
+
+void TrafficObject::regStats()
+{
+	SimObject::regStats();
+
+	reads.name(name()+".reads")
+			 .desc("Number of read requests completed");
+
+	writes.name(name()+".writes")
+				.desc("Number of write requests completed");
+
+	bytesRead.name(name()+".bytesRead")
+					 .desc("Bytes read");
+
+	bytesWritten.name(name()+".bytesWritten")
+							.desc("Bytes written");
+
+	latency.name(name()+".latency")
+				 .desc("Histogram of request latencies in ticks")
+				 .init(16);
+
+	bandwidth.name(name()+".bandwidth")
+					 .desc("Achieved bandwidth in bytes/s")
+					 .precision(0);
+	bandwidth = (bytesRead + bytesWritten) / simSeconds;
+
+	latencyP50.name(name()+".latencyP50")
+						.desc("Median request latency in ticks");
+
+	latencyP90.name(name()+".latencyP90")
+						.desc("90th percentile request latency in ticks");
+
+	latencyP99.name(name()+".latencyP99")
+						.desc("99th percentile request latency in ticks");
+
+	hostSeconds.name(name()+".hostSeconds")
+						 .desc("Host time from startup to the last response");
+
+	hostRequestRate.name(name()+".hostRequestRate")
+								 .desc("Requests simulated per host second")
+								 .precision(0);
+	hostRequestRate = (reads + writes) / hostSeconds;
+}
+
+TrafficObject* TrafficObjectParams::create()
+{
+	return new TrafficObject(this);
+}
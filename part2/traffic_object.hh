@@ -0,0 +1,98 @@
+#ifndef __LEARNING_GEM5_PART2_TRAFFIC_OBJECT_HH__
+#define __LEARNING_GEM5_PART2_TRAFFIC_OBJECT_HH__
+
+#include <chrono>
+#include <vector>
+
+#include "base/random.hh"
+#include "base/statistics.hh"
+#include "enums/TOPattern.hh"
+#include "mem/port.hh"
+#include "params/TrafficObject.hh"
+#include "sim/sim_object.hh"
+
+class TrafficObject;
+
+class TrafficPort : public MasterPort
+{
+	private:
+		TrafficObject *owner;
+		PacketPtr blockedPacket;
+
+	public:
+		TrafficPort(const std::string& name, TrafficObject *owner) :
+			MasterPort(name, (SimObject*) owner), owner(owner), blockedPacket(nullptr)
+			{}
+
+		void sendPacket(PacketPtr pkt);
+		bool isBlocked() const { return blockedPacket != nullptr; }
+
+	protected:
+		bool recvTimingResp(PacketPtr pkt) override;
+		void recvReqRetry() override;
+};
+
+//Synthetic traffic for the learning_gem5 memory objects, without a CPU in front of them. Sends
+//num_requests requests with the given address pattern and read/write mix, one every interval while
+//fewer than max_outstanding wait for a response. PointerChase requests depend on each other, the next
+//one is only sent once the last one got its response. Exits the simulation after the last response
+//and prints the achieved bandwidth, the latency percentiles and the host time it took.
+class TrafficObject : public SimObject
+{
+	private:
+		void processEvent();
+		Addr nextAddr();
+		void finish();
+
+		TrafficPort port;
+		EventFunctionWrapper event;
+
+		const TOPattern pattern;
+		const Addr startAddr;
+		const uint64_t rangeSize;
+		const unsigned requestSize;
+		const unsigned stride;
+		const unsigned readPercent;
+		const Tick interval;
+		const unsigned maxOutstanding;
+		const Counter numRequests;
+		MasterID masterId;
+
+		Random rng;
+		//requests sent, and responses received
+		Counter sent;
+		Counter received;
+		unsigned outstanding;
+		//position of the next request, in requests (Linear, Strided) or blocks (PointerChase)
+		uint64_t position;
+
+		//latency of every request, for the percentiles
+		std::vector<Tick> latencies;
+		std::chrono::steady_clock::time_point hostStart;
+
+		Stats::Scalar reads;
+		Stats::Scalar writes;
+		Stats::Scalar bytesRead;
+		Stats::Scalar bytesWritten;
+		Stats::Histogram latency;
+		Stats::Formula bandwidth;
+		Stats::Scalar latencyP50;
+		Stats::Scalar latencyP90;
+		Stats::Scalar latencyP99;
+		Stats::Scalar hostSeconds;
+		Stats::Formula hostRequestRate;
+
+	public:
+		TrafficObject(TrafficObjectParams *params);
+
+		Port &getPort(const std::string &if_name, PortID idx = InvalidPortID) override;
+
+		void startup() override;
+		void regStats() override;
+
+		bool handleResponse(PacketPtr pkt);
+		//called by port once a request waiting for a retry has been sent
+		void handleReqRetry();
+};
+
+#endif